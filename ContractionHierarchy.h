@@ -0,0 +1,588 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <istream>
+#include <ostream>
+#include <type_traits>
+#include "Graph.h"
+
+namespace graph_detail {
+    /*!
+     * \brief Запись ключа в двоичный поток (арифметические типы - как есть)
+     */
+    template<typename key_type>
+    typename std::enable_if<std::is_arithmetic<key_type>::value>::type
+    write_key(std::ostream& out, const key_type& key) {
+        out.write(reinterpret_cast<const char*>(&key), sizeof(key));
+    }
+
+    /*!
+     * \brief Запись ключа-строки в двоичный поток (длина и символы)
+     */
+    inline void write_key(std::ostream& out, const std::string& key) {
+        uint64_t length = key.size();
+        out.write(reinterpret_cast<const char*>(&length), sizeof(length));
+        out.write(key.data(), static_cast<std::streamsize>(length));
+    }
+
+    /*!
+     * \brief Чтение ключа из двоичного потока (арифметические типы - как есть)
+     */
+    template<typename key_type>
+    typename std::enable_if<std::is_arithmetic<key_type>::value>::type
+    read_key(std::istream& in, key_type& key) {
+        in.read(reinterpret_cast<char*>(&key), sizeof(key));
+    }
+
+    /*!
+     * \brief Чтение ключа-строки из двоичного потока
+     */
+    inline void read_key(std::istream& in, std::string& key) {
+        uint64_t length = 0;
+        in.read(reinterpret_cast<char*>(&length), sizeof(length));
+        key.resize(length);
+        in.read(&key[0], static_cast<std::streamsize>(length));
+    }
+
+    template<typename value_t>
+    void write_vector(std::ostream& out, const std::vector<value_t>& v) {
+        static_assert(std::is_trivially_copyable<value_t>::value, "only trivially copyable arrays are written as is");
+        uint64_t size = v.size();
+        out.write(reinterpret_cast<const char*>(&size), sizeof(size));
+        out.write(reinterpret_cast<const char*>(v.data()), static_cast<std::streamsize>(size * sizeof(value_t)));
+    }
+
+    template<typename value_t>
+    void read_vector(std::istream& in, std::vector<value_t>& v) {
+        uint64_t size = 0;
+        in.read(reinterpret_cast<char*>(&size), sizeof(size));
+        v.resize(size);
+        in.read(reinterpret_cast<char*>(v.data()), static_cast<std::streamsize>(size * sizeof(value_t)));
+    }
+}
+
+/*!
+ * \brief Иерархия сжатия (Contraction Hierarchies) для быстрых запросов кратчайшего пути
+ * \details Вершины по очереди удаляются ("сжимаются") из графа, и если кратчайший путь между соседями шёл через
+ * удаляемую вершину, между ними добавляется ребро-сокращение. Номер вершины в этом порядке - её ранг.
+ * Запрос - двунаправленный Дейкстра, который из начала идёт только вверх по рангу, а из конца - только вниз,
+ * поэтому просматривает очень малую часть графа. Сокращения в найденном пути раскрываются до исходных рёбер.
+ * Вершины нумеруются так же, как в CsrGraph того же графа.
+ * @tparam key_type
+ * @tparam weight_type
+ */
+template<typename key_type, typename weight_type>
+class ContractionHierarchy {
+public:
+    static constexpr uint32_t NONE = std::numeric_limits<uint32_t>::max();
+    static constexpr weight_type INF = std::numeric_limits<weight_type>::max();
+
+    /*!
+     * \brief Ребро иерархии
+     */
+    struct Arc {
+        uint32_t node;      // другой конец ребра
+        uint32_t middle;    // сжатая вершина, через которую идёт сокращение, или NONE для исходного ребра
+        weight_type weight;
+    };
+
+private:
+    std::vector<key_type> keys;       // keys[v] - ключ вершины v
+    std::vector<uint32_t> rank;       // rank[v] - порядок сжатия вершины v
+    std::vector<size_t> up_offsets;   // up_arcs[up_offsets[v]..]: рёбра v -> x, rank[x] > rank[v]
+    std::vector<Arc> up_arcs;
+    std::vector<size_t> down_offsets; // down_arcs[down_offsets[v]..]: рёбра u -> v, rank[u] > rank[v] (node = u)
+    std::vector<Arc> down_arcs;
+
+    /*!
+     * \brief Рабочие данные предобработки
+     */
+    struct Builder {
+        std::vector<std::vector<Arc>> out, in;     // рёбра ещё не сжатой части графа
+        std::vector<int> edge_difference;          // последняя оценка разности рёбер
+        std::vector<int> deleted_neighbors;
+        std::vector<int> level;                    // верхняя оценка глубины поиска вниз от вершины
+        std::vector<char> target;                  // target[x] - x является концом возможного сокращения
+        DijkstraWorkspace<weight_type> witness;
+        size_t settle_limit;                       // предел поиска свидетеля при настоящем сжатии
+        size_t simulate_limit;                     // предел при оценке приоритета (оценка может быть завышенной)
+
+        /*!
+         * \brief Добавление ребра u -> x (или уменьшение веса уже существующего)
+         */
+        void add_arc(uint32_t u, uint32_t x, weight_type weight, uint32_t middle) {
+            for (Arc& arc : out[u]) {
+                if (arc.node == x) {
+                    if (weight < arc.weight) {
+                        arc.weight = weight;
+                        arc.middle = middle;
+                        for (Arc& back : in[x]) {
+                            if (back.node == u) {
+                                back.weight = weight;
+                                back.middle = middle;
+                            }
+                        }
+                    }
+                    return;
+                }
+            }
+            out[u].push_back(Arc{x, middle, weight});
+            in[x].push_back(Arc{u, middle, weight});
+        }
+
+        /*!
+         * \brief Поиск путей-свидетелей из u в оставшемся графе без вершины skip
+         * \details Останавливается, когда просмотрены все targets отмеченных вершин, на расстоянии max_dist
+         * или после limit просмотренных вершин. В последних двух случаях может не найти существующего
+         * свидетеля - тогда добавится лишнее, но корректное сокращение.
+         */
+        void witness_search(uint32_t u, uint32_t skip, weight_type max_dist, size_t targets, size_t limit) {
+            witness.prepare(out.size());
+            witness.relax(u, 0, NONE);
+            size_t settled = 0;
+
+            while (!witness.queue.empty()) {
+                auto [dist, v] = witness.queue.pop();
+                if (witness.used[v] || witness.d[v] < dist) {
+                    continue;
+                }
+                witness.used[v] = true;
+                if (dist > max_dist || ++settled > limit) {
+                    break;
+                }
+                if (target[v] && v != u && --targets == 0) {
+                    break;
+                }
+
+                for (const Arc& arc : out[v]) {
+                    if (arc.node != skip && dist + arc.weight < witness.d[arc.node]) {
+                        witness.relax(arc.node, dist + arc.weight, v);
+                    }
+                }
+            }
+        }
+
+        /*!
+         * \brief Сжатие вершины v (или только подсчёт нужных сокращений при simulate == true)
+         * @return Количество сокращений.
+         */
+        int contract(uint32_t v, bool simulate) {
+            int shortcuts = 0;
+            if (out[v].empty()) {
+                return shortcuts;
+            }
+
+            for (const Arc& outgoing : out[v]) {
+                target[outgoing.node] = true;
+            }
+
+            for (size_t i = 0; i < in[v].size(); ++i) {
+                Arc incoming = in[v][i];
+                weight_type max_dist = 0;
+                size_t targets = 0;
+                for (const Arc& outgoing : out[v]) {
+                    if (outgoing.node != incoming.node) {
+                        max_dist = std::max(max_dist, incoming.weight + outgoing.weight);
+                        ++targets;
+                    }
+                }
+                if (targets == 0) {
+                    continue;
+                }
+
+                witness_search(incoming.node, v, max_dist, targets, simulate ? simulate_limit : settle_limit);
+
+                for (size_t j = 0; j < out[v].size(); ++j) {
+                    Arc outgoing = out[v][j];
+                    if (outgoing.node == incoming.node) {
+                        continue;
+                    }
+                    weight_type through = incoming.weight + outgoing.weight;
+                    if (witness.d[outgoing.node] > through) {
+                        ++shortcuts;
+                        if (!simulate) {
+                            add_arc(incoming.node, outgoing.node, through, v);
+                        }
+                    }
+                }
+            }
+
+            for (const Arc& outgoing : out[v]) {
+                target[outgoing.node] = false;
+            }
+            return shortcuts;
+        }
+
+        /*!
+         * \brief Приоритет сжатия по последней оценке разности рёбер (без поиска свидетелей)
+         */
+        int priority(uint32_t v) const {
+            return 2 * edge_difference[v] + deleted_neighbors[v] + level[v];
+        }
+
+        /*!
+         * \brief Пересчёт разности рёбер (сокращения минус удаляемые рёбра) и приоритета сжатия
+         */
+        int evaluate(uint32_t v) {
+            int removed = static_cast<int>(in[v].size() + out[v].size());
+            edge_difference[v] = contract(v, true) - removed;
+            return priority(v);
+        }
+
+        /*!
+         * \brief Удаление вершины v из оставшегося графа
+         * @param neighbors - сюда дописываются соседи v, чьи приоритеты нужно пересчитать
+         */
+        void remove(uint32_t v, std::vector<uint32_t>& neighbors) {
+            neighbors.clear();
+            for (const Arc& incoming : in[v]) {
+                auto& list = out[incoming.node];
+                list.erase(std::remove_if(list.begin(), list.end(), [v](const Arc& arc) { return arc.node == v; }), list.end());
+                neighbors.push_back(incoming.node);
+            }
+            for (const Arc& outgoing : out[v]) {
+                auto& list = in[outgoing.node];
+                list.erase(std::remove_if(list.begin(), list.end(), [v](const Arc& arc) { return arc.node == v; }), list.end());
+                neighbors.push_back(outgoing.node);
+            }
+            std::sort(neighbors.begin(), neighbors.end());
+            neighbors.erase(std::unique(neighbors.begin(), neighbors.end()), neighbors.end());
+            for (uint32_t u : neighbors) {
+                deleted_neighbors[u]++;
+                level[u] = std::max(level[u], level[v] + 1);
+            }
+            std::vector<Arc>().swap(out[v]);
+            std::vector<Arc>().swap(in[v]);
+        }
+    };
+
+    /*!
+     * \brief Ребро вверх u -> x
+     */
+    const Arc& up_arc(uint32_t u, uint32_t x) const {
+        for (size_t e = up_offsets[u]; e < up_offsets[u + 1]; ++e) {
+            if (up_arcs[e].node == x) {
+                return up_arcs[e];
+            }
+        }
+        throw std::logic_error("corrupted contraction hierarchy.\n");
+    }
+
+    /*!
+     * \brief Ребро вниз u -> x (хранится у x)
+     */
+    const Arc& down_arc(uint32_t u, uint32_t x) const {
+        for (size_t e = down_offsets[x]; e < down_offsets[x + 1]; ++e) {
+            if (down_arcs[e].node == u) {
+                return down_arcs[e];
+            }
+        }
+        throw std::logic_error("corrupted contraction hierarchy.\n");
+    }
+
+    /*!
+     * \brief Ребро иерархии u -> x любого направления
+     */
+    const Arc& arc(uint32_t u, uint32_t x) const {
+        return rank[u] < rank[x] ? up_arc(u, x) : down_arc(u, x);
+    }
+
+    /*!
+     * \brief Раскрытие ребра иерархии u -> x в исходные рёбра, вершины после u дописываются в route
+     */
+    template<typename route_t>
+    void unpack(uint32_t u, uint32_t x, route_t& route, std::vector<std::pair<uint32_t, uint32_t>>& stack) const {
+        stack.clear();
+        stack.emplace_back(u, x);
+        while (!stack.empty()) {
+            auto [a, b] = stack.back();
+            stack.pop_back();
+            uint32_t middle = arc(a, b).middle;
+            if (middle == NONE) {
+                route.push_back(keys[b]);
+            } else {
+                stack.emplace_back(middle, b);
+                stack.emplace_back(a, middle);
+            }
+        }
+    }
+
+    /*!
+     * \brief Проверка stall-on-demand: до v можно дойти короче через более высокую вершину
+     * \details Такой v лежит не на кратчайшем пути вверх, и его рёбра можно не просматривать.
+     * @param v
+     * @param dist - найденное расстояние до v
+     * @param d - расстояния текущего направления поиска
+     * @param offsets, arcs - рёбра, входящие в v из более высоких вершин (для поиска назад - исходящие)
+     */
+    static bool stalled(uint32_t v, weight_type dist, const std::vector<weight_type>& d,
+                        const std::vector<size_t>& offsets, const std::vector<Arc>& arcs) {
+        for (size_t e = offsets[v]; e < offsets[v + 1]; ++e) {
+            weight_type higher = d[arcs[e].node];
+            if (higher != INF && higher + arcs[e].weight < dist) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    uint32_t find_index(const key_type& key) const {
+        auto it = std::lower_bound(keys.begin(), keys.end(), key);
+        if (it == keys.end() || key < *it) {
+            throw std::logic_error("no such node in graph.\n");
+        }
+        return static_cast<uint32_t>(it - keys.begin());
+    }
+
+public:
+    /*!
+     * \brief Пустая иерархия (например, для загрузки из потока)
+     */
+    ContractionHierarchy() : up_offsets(1, 0), down_offsets(1, 0) {}
+
+    /*!
+     * \brief Предобработка графа
+     * \details Порядок сжатия выбирается жадно по приоритету (разность рёбер, сжатые соседи, уровень вершины).
+     * Разность рёбер оценивается укороченным поиском свидетелей и пересчитывается лениво при извлечении
+     * вершины из очереди, у соседей сжатой вершины обновляются только дешёвые слагаемые. Веса рёбер должны быть неотрицательными, петли отбрасываются,
+     * из кратных рёбер остаётся самое лёгкое.
+     * @tparam graph_t - Graph или CsrGraph
+     * @param graph
+     * @param witness_settle_limit - сколько вершин может просмотреть один поиск свидетеля при сжатии
+     * (при оценке приоритета - в 10 раз меньше)
+     */
+    template<typename graph_t>
+    explicit ContractionHierarchy(const graph_t& graph, size_t witness_settle_limit = 500) {
+        const auto& csr = graph_detail::as_csr(graph);
+        size_t n = csr.size();
+
+        Builder builder;
+        builder.out.resize(n);
+        builder.in.resize(n);
+        builder.edge_difference.assign(n, 0);
+        builder.deleted_neighbors.assign(n, 0);
+        builder.level.assign(n, 0);
+        builder.target.assign(n, false);
+        builder.settle_limit = witness_settle_limit;
+        builder.simulate_limit = std::max<size_t>(witness_settle_limit / 10, 1);
+
+        keys.reserve(n);
+        for (uint32_t v = 0; v < n; ++v) {
+            keys.push_back(csr.key(v));
+            for (size_t e = csr.edges_begin(v); e < csr.edges_end(v); ++e) {
+                if (csr.weight(e) < 0) {
+                    throw std::logic_error("there are negative weights in the graph.\n");
+                }
+                if (csr.target(e) != v) {
+                    builder.add_arc(v, csr.target(e), csr.weight(e), NONE);
+                }
+            }
+        }
+
+        IndexedDaryHeap<int> order(n);
+        for (uint32_t v = 0; v < n; ++v) {
+            order.push(v, builder.evaluate(v));
+        }
+
+        rank.assign(n, NONE);
+        std::vector<std::vector<Arc>> up(n), down(n);
+        std::vector<uint32_t> neighbors;
+        uint32_t next_rank = 0;
+        while (!order.empty()) {
+            uint32_t v = order.pop().second;
+            int actual = builder.evaluate(v);
+            if (!order.empty() && actual > order.top().first) {
+                order.push(v, actual);
+                continue;
+            }
+
+            builder.contract(v, false);
+            rank[v] = next_rank++;
+            up[v] = builder.out[v];
+            down[v] = builder.in[v];
+            builder.remove(v, neighbors);
+            for (uint32_t u : neighbors) {
+                order.update(u, builder.priority(u));
+            }
+        }
+
+        up_offsets.assign(1, 0);
+        down_offsets.assign(1, 0);
+        for (uint32_t v = 0; v < n; ++v) {
+            up_arcs.insert(up_arcs.end(), up[v].begin(), up[v].end());
+            down_arcs.insert(down_arcs.end(), down[v].begin(), down[v].end());
+            up_offsets.push_back(up_arcs.size());
+            down_offsets.push_back(down_arcs.size());
+        }
+    }
+
+    /*!
+     * \brief Количество вершин
+     * @return Число вершин.
+     */
+    size_t size() const noexcept {
+        return keys.size();
+    }
+
+    /*!
+     * \brief Количество рёбер иерархии (исходные рёбра и сокращения)
+     * @return Число рёбер.
+     */
+    size_t arc_count() const noexcept {
+        return up_arcs.size() + down_arcs.size();
+    }
+
+    /*!
+     * \brief Запрос кратчайшего пути с переиспользуемыми буферами
+     * @tparam route_t
+     * @tparam queue_t
+     * @param key_from
+     * @param key_to
+     * @param route - буфер для пути
+     * @param forward - рабочие буферы поиска вверх из key_from
+     * @param backward - рабочие буферы поиска вверх из key_to по обратным рёбрам
+     * @return Длина кратчайшего пути из вершины с ключом key_from в вершину с ключом key_to.
+     */
+    template<typename route_t, typename queue_t>
+    weight_type query(const key_type& key_from, const key_type& key_to, route_t& route,
+                      DijkstraWorkspace<weight_type, queue_t>& forward,
+                      DijkstraWorkspace<weight_type, queue_t>& backward) const {
+        uint32_t from = find_index(key_from), to = find_index(key_to);
+
+        forward.prepare(keys.size());
+        backward.prepare(keys.size());
+        forward.relax(from, 0, NONE);
+        backward.relax(to, 0, NONE);
+
+        weight_type best = INF;
+        uint32_t meet = NONE;
+        bool forward_done = false, backward_done = false;
+
+        while (true) {
+            forward_done = forward_done || forward.queue.empty() || !(forward.queue.top().first < best);
+            backward_done = backward_done || backward.queue.empty() || !(backward.queue.top().first < best);
+            if (forward_done && backward_done) {
+                break;
+            }
+
+            bool go_forward = !forward_done &&
+                              (backward_done || forward.queue.top().first <= backward.queue.top().first);
+            auto& ws = go_forward ? forward : backward;
+            auto& other = go_forward ? backward : forward;
+
+            auto [dist, v] = ws.queue.pop();
+            if (ws.used[v] || ws.d[v] < dist) {
+                continue;
+            }
+            ws.used[v] = true;
+
+            if (other.d[v] != INF && dist + other.d[v] < best) {
+                best = dist + other.d[v];
+                meet = v;
+            }
+
+            const std::vector<size_t>& offsets = go_forward ? up_offsets : down_offsets;
+            const std::vector<Arc>& arcs = go_forward ? up_arcs : down_arcs;
+            if (stalled(v, dist, ws.d, go_forward ? down_offsets : up_offsets, go_forward ? down_arcs : up_arcs)) {
+                continue;
+            }
+            for (size_t e = offsets[v]; e < offsets[v + 1]; ++e) {
+                uint32_t u = arcs[e].node;
+                if (dist + arcs[e].weight < ws.d[u]) {
+                    ws.relax(u, dist + arcs[e].weight, v);
+                }
+            }
+        }
+
+        if (meet == NONE) {
+            throw std::logic_error("nodes are not connected.\n");
+        }
+
+        // вершины пути в иерархии: from -> ... -> meet -> ... -> to
+        std::vector<uint32_t> hops;
+        for (uint32_t v = meet; v != NONE; v = forward.route_tmp[v]) {
+            hops.push_back(v);
+        }
+        std::reverse(hops.begin(), hops.end());
+        for (uint32_t v = backward.route_tmp[meet]; v != NONE; v = backward.route_tmp[v]) {
+            hops.push_back(v);
+        }
+
+        route.clear();
+        route.push_back(keys[from]);
+        std::vector<std::pair<uint32_t, uint32_t>> stack;
+        for (size_t i = 0; i + 1 < hops.size(); ++i) {
+            unpack(hops[i], hops[i + 1], route, stack);
+        }
+
+        return best;
+    }
+
+    /*!
+     * \brief Запрос кратчайшего пути
+     * @tparam route_t
+     * @param key_from
+     * @param key_to
+     * @return Длина кратчайшего пути из вершины с ключом key_from в вершину с ключом key_to и сам путь
+     * (сокращения раскрыты до исходных рёбер).
+     */
+    template<typename route_t>
+    std::pair<weight_type, route_t> query(const key_type& key_from, const key_type& key_to) const {
+        DijkstraWorkspace<weight_type> forward, backward;
+        route_t route;
+
+        weight_type weight = query(key_from, key_to, route, forward, backward);
+
+        return std::pair<weight_type, route_t>(weight, route);
+    }
+
+    /*!
+     * \brief Сохранение иерархии в двоичный поток
+     * @param out
+     */
+    void save(std::ostream& out) const {
+        out.write("CH01", 4);
+        uint64_t n = keys.size();
+        out.write(reinterpret_cast<const char*>(&n), sizeof(n));
+        for (const auto& key : keys) {
+            graph_detail::write_key(out, key);
+        }
+        graph_detail::write_vector(out, rank);
+        graph_detail::write_vector(out, up_offsets);
+        graph_detail::write_vector(out, up_arcs);
+        graph_detail::write_vector(out, down_offsets);
+        graph_detail::write_vector(out, down_arcs);
+    }
+
+    /*!
+     * \brief Загрузка иерархии из двоичного потока
+     * @param in
+     * @return Иерархия, сохранённая методом save().
+     */
+    static ContractionHierarchy load(std::istream& in) {
+        char magic[4] = {};
+        in.read(magic, 4);
+        if (std::string(magic, 4) != "CH01") {
+            throw std::logic_error("stream does not contain a contraction hierarchy.\n");
+        }
+
+        ContractionHierarchy hierarchy;
+        uint64_t n = 0;
+        in.read(reinterpret_cast<char*>(&n), sizeof(n));
+        hierarchy.keys.resize(n);
+        for (auto& key : hierarchy.keys) {
+            graph_detail::read_key(in, key);
+        }
+        graph_detail::read_vector(in, hierarchy.rank);
+        graph_detail::read_vector(in, hierarchy.up_offsets);
+        graph_detail::read_vector(in, hierarchy.up_arcs);
+        graph_detail::read_vector(in, hierarchy.down_offsets);
+        graph_detail::read_vector(in, hierarchy.down_arcs);
+
+        if (!in) {
+            throw std::logic_error("contraction hierarchy stream is truncated.\n");
+        }
+        return hierarchy;
+    }
+};
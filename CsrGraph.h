@@ -0,0 +1,488 @@
+#pragma once
+
+#include <vector>
+#include <utility>
+#include <iterator>
+#include <algorithm>
+#include <stdexcept>
+#include <cstdint>
+#include <cstddef>
+#include <limits>
+
+/*!
+ * \brief Неизменяемый снимок графа в формате CSR
+ * \details Вершины пронумерованы подряд числами uint32_t в порядке возрастания ключей,
+ * исходящие рёбра вершины v лежат в targets/weights на отрезке [offsets[v], offsets[v + 1]),
+ * входящие (обратные) рёбра - в sources/in_weights на отрезке [in_offsets[v], in_offsets[v + 1]).
+ * Интерфейс обхода совпадает с Graph, поэтому снимок можно передавать в те же шаблоны (dijkstra, print).
+ * @tparam key_type
+ * @tparam value_type
+ * @tparam weight_type
+ */
+template<typename key_type, typename value_type, typename weight_type>
+class CsrGraph {
+public:
+    /*!
+     * \brief Тип номера вершины
+     */
+    typedef uint32_t index_type;
+
+    /*!
+     * \brief Номер, означающий отсутствие вершины
+     */
+    static constexpr index_type npos = std::numeric_limits<index_type>::max();
+
+private:
+    std::vector<key_type> keys;        // keys[v] - ключ вершины v, по возрастанию
+    std::vector<value_type> values;    // values[v] - значение в вершине v
+    std::vector<size_t> offsets;       // начало рёбер вершины v
+    std::vector<index_type> targets;   // номер вершины, куда идёт ребро
+    std::vector<weight_type> weights;  // вес ребра
+    std::vector<size_t> in_offsets;       // начало входящих рёбер вершины v
+    std::vector<index_type> sources;      // номер вершины, откуда идёт входящее ребро
+    std::vector<weight_type> in_weights;  // вес входящего ребра
+    bool negative_weights = false;        // есть ли ребро с отрицательным весом
+
+    /*!
+     * \brief Построение обратных рёбер по прямым (сортировка подсчётом) и проверка знаков весов
+     */
+    void build_reverse() {
+        negative_weights = std::any_of(weights.begin(), weights.end(), [](const weight_type& weight) {
+            return weight < weight_type(0);
+        });
+
+        in_offsets.assign(keys.size() + 1, 0);
+        for (index_type target : targets) {
+            in_offsets[target + 1]++;
+        }
+        for (size_t v = 0; v < keys.size(); ++v) {
+            in_offsets[v + 1] += in_offsets[v];
+        }
+
+        sources.resize(targets.size());
+        in_weights.resize(targets.size());
+        std::vector<size_t> next(in_offsets.begin(), in_offsets.end() - 1);
+        for (index_type v = 0; v < keys.size(); ++v) {
+            for (size_t e = offsets[v]; e < offsets[v + 1]; ++e) {
+                size_t slot = next[targets[e]]++;
+                sources[slot] = v;
+                in_weights[slot] = weights[e];
+            }
+        }
+    }
+
+    /*!
+     * \brief Номер вершины по ключу (или npos, если ключа нет)
+     * @param key
+     * @return Номер вершины.
+     */
+    index_type find_index(const key_type& key) const {
+        auto it = std::lower_bound(keys.begin(), keys.end(), key);
+        if (it == keys.end() || key < *it) {
+            return npos;
+        }
+        return static_cast<index_type>(it - keys.begin());
+    }
+
+public:
+    /*!
+     * \brief Итератор по рёбрам вершины
+     * \details При разыменовании даёт пару (ключ вершины, куда идёт ребро; вес ребра).
+     */
+    class edge_iterator {
+        const CsrGraph* owner;
+        size_t e;
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef std::pair<const key_type&, const weight_type&> reference;
+        typedef std::ptrdiff_t difference_type;
+
+        /*!
+         * \brief Прокси для operator->
+         */
+        struct pointer {
+            reference pair;
+            const reference* operator->() const { return &pair; }
+        };
+
+        edge_iterator(const CsrGraph* owner, size_t e) : owner(owner), e(e) {}
+
+        reference operator*() const {
+            return reference(owner->keys[owner->targets[e]], owner->weights[e]);
+        }
+        pointer operator->() const {
+            return pointer{**this};
+        }
+        edge_iterator& operator++() {
+            ++e;
+            return *this;
+        }
+        edge_iterator operator++(int) {
+            edge_iterator tmp = *this;
+            ++e;
+            return tmp;
+        }
+        bool operator==(const edge_iterator& rhs) const { return e == rhs.e; }
+        bool operator!=(const edge_iterator& rhs) const { return e != rhs.e; }
+    };
+
+    /*!
+     * \brief Вершина снимка (лёгкое представление без копирования рёбер)
+     */
+    class Node {
+        const CsrGraph* owner;
+        index_type v;
+    public:
+        typedef edge_iterator iterator;
+        typedef edge_iterator const_iterator;
+
+        Node(const CsrGraph* owner, index_type v) : owner(owner), v(v) {}
+
+        /*!
+         * \brief Номер вершины в снимке
+         * @return Номер вершины.
+         */
+        index_type index() const noexcept {
+            return v;
+        }
+        /*!
+         * \brief Проверка на отсутствие исходящих рёбер
+         * @return bool - true если рёбер нет, false - иначе.
+         */
+        bool empty() const noexcept {
+            return size() == 0;
+        }
+        /*!
+         * \brief Количество исходящих рёбер
+         * @return Количество исходящих из вершины рёбер
+         */
+        size_t size() const noexcept {
+            return owner->offsets[v + 1] - owner->offsets[v];
+        }
+        /*!
+         * \brief Значение в вершине
+         * @return Значение, находящееся в вершине
+         */
+        const value_type& value() const {
+            return owner->values[v];
+        }
+
+        const_iterator begin() const noexcept {
+            return const_iterator(owner, owner->offsets[v]);
+        }
+        const_iterator end() const noexcept {
+            return const_iterator(owner, owner->offsets[v + 1]);
+        }
+        const_iterator cbegin() const noexcept {
+            return begin();
+        }
+        const_iterator cend() const noexcept {
+            return end();
+        }
+    };
+
+    /*!
+     * \brief Итератор по вершинам снимка
+     * \details При разыменовании даёт пару (ключ вершины; вершина).
+     */
+    class node_iterator {
+        const CsrGraph* owner;
+        index_type v;
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef std::pair<const key_type&, Node> reference;
+        typedef std::ptrdiff_t difference_type;
+
+        /*!
+         * \brief Прокси для operator->
+         */
+        struct pointer {
+            reference pair;
+            const reference* operator->() const { return &pair; }
+        };
+
+        node_iterator(const CsrGraph* owner, index_type v) : owner(owner), v(v) {}
+
+        reference operator*() const {
+            return reference(owner->keys[v], Node(owner, v));
+        }
+        pointer operator->() const {
+            return pointer{**this};
+        }
+        node_iterator& operator++() {
+            ++v;
+            return *this;
+        }
+        node_iterator operator++(int) {
+            node_iterator tmp = *this;
+            ++v;
+            return tmp;
+        }
+        bool operator==(const node_iterator& rhs) const { return v == rhs.v; }
+        bool operator!=(const node_iterator& rhs) const { return v != rhs.v; }
+    };
+
+    typedef node_iterator iterator;
+    typedef node_iterator const_iterator;
+
+    /*!
+     * \brief Дефолтный конструктор (пустой снимок)
+     */
+    CsrGraph() : offsets(1, 0), in_offsets(1, 0) {}
+
+    /*!
+     * \brief Построение снимка по графу
+     * \details Подходит любой граф с интерфейсом обхода Graph, ключи которого при обходе идут по возрастанию.
+     * Рёбра в ключи, которых нет среди вершин, в снимок не попадают.
+     * @tparam graph_t
+     * @param graph
+     */
+    template<typename graph_t>
+    explicit CsrGraph(const graph_t& graph)
+            : CsrGraph(graph, [this](const key_type& key) { return find_index(key); }) {}
+
+    /*!
+     * \brief Построение снимка по графу с заданным поиском номера вершины по ключу
+     * @tparam graph_t
+     * @tparam resolve_t
+     * @param graph
+     * @param resolve - функция ключ -> номер в снимке (npos, если такой вершины нет)
+     */
+    template<typename graph_t, typename resolve_t>
+    CsrGraph(const graph_t& graph, resolve_t resolve) {
+        keys.reserve(graph.size());
+        values.reserve(graph.size());
+        size_t edge_count = 0;
+        for (const auto& [key, node] : graph) {
+            keys.push_back(key);
+            values.push_back(node.value());
+            edge_count += node.size();
+        }
+
+        offsets.reserve(keys.size() + 1);
+        targets.reserve(edge_count);
+        weights.reserve(edge_count);
+        offsets.push_back(0);
+        for (const auto& [key, node] : graph) {
+            for (const auto& [to, weight] : node) {
+                index_type target = resolve(to);
+                if (target != npos) {
+                    targets.push_back(target);
+                    weights.push_back(weight);
+                }
+            }
+            offsets.push_back(targets.size());
+        }
+
+        build_reverse();
+    }
+
+    /*!
+     * \brief Построение снимка из готовых массивов
+     * \details Ключи идут по возрастанию, рёбра вершины v лежат в targets/weights на отрезке [offsets[v], offsets[v + 1]).
+     * @param keys
+     * @param values
+     * @param offsets
+     * @param targets
+     * @param weights
+     */
+    CsrGraph(std::vector<key_type> keys, std::vector<value_type> values, std::vector<size_t> offsets,
+             std::vector<index_type> targets, std::vector<weight_type> weights)
+            : keys(std::move(keys)), values(std::move(values)), offsets(std::move(offsets)),
+              targets(std::move(targets)), weights(std::move(weights)) {
+        build_reverse();
+    }
+
+    /*!
+     * \brief Проверка на пустоту снимка
+     * @return bool - true, если вершин нет, false - иначе.
+     */
+    bool empty() const noexcept {
+        return keys.empty();
+    }
+    /*!
+     * \brief Количество вершин
+     * @return Число вершин.
+     */
+    size_t size() const noexcept {
+        return keys.size();
+    }
+    /*!
+     * \brief Количество рёбер
+     * @return Число рёбер.
+     */
+    size_t edge_count() const noexcept {
+        return targets.size();
+    }
+
+    const_iterator begin() const noexcept {
+        return const_iterator(this, 0);
+    }
+    const_iterator end() const noexcept {
+        return const_iterator(this, static_cast<index_type>(keys.size()));
+    }
+    const_iterator cbegin() const noexcept {
+        return begin();
+    }
+    const_iterator cend() const noexcept {
+        return end();
+    }
+
+    /*!
+     * \brief Проверка на наличие вершины
+     * @param key
+     * @return bool - true, если вершина есть, false - иначе.
+     */
+    bool contains(const key_type& key) const {
+        return find_index(key) != npos;
+    }
+
+    /*!
+     * \brief Номер вершины по ключу
+     * @param key
+     * @return Номер вершины в снимке.
+     */
+    index_type index(const key_type& key) const {
+        index_type v = find_index(key);
+        if (v == npos) {
+            throw std::logic_error("no node with this key in the graph.");
+        }
+        return v;
+    }
+
+    /*!
+     * \brief Ключ вершины по номеру
+     * @param v
+     * @return Ключ вершины.
+     */
+    const key_type& key(index_type v) const {
+        return keys[v];
+    }
+
+    /*!
+     * \brief Значение в вершине по номеру
+     * @param v
+     * @return Значение в вершине.
+     */
+    const value_type& value(index_type v) const {
+        return values[v];
+    }
+
+    /*!
+     * \brief Начало рёбер вершины
+     * @param v
+     * @return Номер первого исходящего ребра вершины v.
+     */
+    size_t edges_begin(index_type v) const {
+        return offsets[v];
+    }
+    /*!
+     * \brief Конец рёбер вершины
+     * @param v
+     * @return Номер ребра, следующего за последним исходящим ребром вершины v.
+     */
+    size_t edges_end(index_type v) const {
+        return offsets[v + 1];
+    }
+    /*!
+     * \brief Куда идёт ребро
+     * @param e
+     * @return Номер вершины, в которую идёт ребро e.
+     */
+    index_type target(size_t e) const {
+        return targets[e];
+    }
+    /*!
+     * \brief Вес ребра
+     * @param e
+     * @return Вес ребра e.
+     */
+    const weight_type& weight(size_t e) const {
+        return weights[e];
+    }
+
+    /*!
+     * \brief Есть ли в снимке рёбра с отрицательным весом
+     * \details Считается один раз при построении снимка, чтобы поиски, которые останавливаются до просмотра всех
+     * рёбер (Дейкстра до цели, A*, таблица расстояний), не пропускали отрицательные веса.
+     * @return bool - true, если хотя бы один вес меньше нуля, false - иначе.
+     */
+    bool has_negative_weights() const noexcept {
+        return negative_weights;
+    }
+
+    /*!
+     * \brief Начало входящих рёбер вершины
+     * @param v
+     * @return Номер первого входящего ребра вершины v.
+     */
+    size_t in_edges_begin(index_type v) const {
+        return in_offsets[v];
+    }
+    /*!
+     * \brief Конец входящих рёбер вершины
+     * @param v
+     * @return Номер ребра, следующего за последним входящим ребром вершины v.
+     */
+    size_t in_edges_end(index_type v) const {
+        return in_offsets[v + 1];
+    }
+    /*!
+     * \brief Откуда идёт входящее ребро
+     * @param e
+     * @return Номер вершины, из которой идёт входящее ребро e.
+     */
+    index_type source(size_t e) const {
+        return sources[e];
+    }
+    /*!
+     * \brief Вес входящего ребра
+     * @param e
+     * @return Вес входящего ребра e.
+     */
+    const weight_type& in_weight(size_t e) const {
+        return in_weights[e];
+    }
+
+    /*!
+     * \brief Доступ к вершине по ключу
+     * @param key
+     * @return Вершина с таким ключом.
+     */
+    Node operator[](const key_type& key) const {
+        index_type v = find_index(key);
+        if (v == npos) {
+            throw std::logic_error("no such node in graph.\n");
+        }
+        return Node(this, v);
+    }
+
+    /*!
+     * \brief Доступ к вершине по ключу
+     * @param key
+     * @return Вершина с таким ключом.
+     */
+    Node at(const key_type& key) const {
+        return Node(this, index(key));
+    }
+
+    /*!
+     * \brief Степень (выходящие рёбра)
+     * @param key
+     * @return Степень вершины по выходящим рёбрам.
+     */
+    size_t degree_out(const key_type& key) const {
+        index_type v = index(key);
+        return offsets[v + 1] - offsets[v];
+    }
+
+    /*!
+     * \brief Степень (входящие рёбра)
+     * @param key
+     * @return Степень вершины по входящим рёбрам.
+     */
+    size_t degree_in(const key_type& key) const {
+        index_type v = index(key);
+        return in_offsets[v + 1] - in_offsets[v];
+    }
+};
@@ -0,0 +1,313 @@
+#pragma once
+
+#include <initializer_list>
+#include <stdexcept>
+#include <iomanip>
+#include <cstddef>
+#include "Matrix.h"
+
+namespace linalg {
+    /*!
+        \brief Матрица с размерами, известными при компиляции
+
+        \details Элементы лежат внутри объекта (по строкам), без выделения памяти; все операции constexpr,
+        циклы имеют постоянные границы, и компилятор разворачивает их полностью. Подходит для преобразований
+        3 x 3 и 4 x 4 в геометрии. Матрица является выражением (MatrixExpression), поэтому неявно превращается
+        в Matrix<T> и участвует в ленивых выражениях вместе с ней; обратно - явным конструктором.
+        @tparam T - тип элементов
+        @tparam R, C - число строк и столбцов
+    */
+    template<class T, unsigned R, unsigned C>
+    class FixedMatrix : public MatrixExpression<FixedMatrix<T, R, C>> {
+        static_assert(R > 0 && C > 0, "fixed matrix dimensions must be positive");
+
+        T m_data[R * C];
+
+    public:
+        typedef T value_type;
+
+        /*!
+            \brief Конструктор по умолчанию (нулевая матрица)
+         */
+        constexpr FixedMatrix() : m_data{} {}
+
+        /*!
+            \brief Конструктор для ситуаций m = {{1, 2, 3}, {4, 5, 6}}
+            @param lst
+         */
+        constexpr FixedMatrix(std::initializer_list<std::initializer_list<T>> lst) : m_data{} {
+            if (lst.size() != R) {
+                throw std::logic_error("matrix dimensions are not matching\n");
+            }
+            unsigned i = 0;
+            for (const std::initializer_list<T> &row : lst) {
+                if (row.size() != C) {
+                    throw std::logic_error("matrix dimensions are not matching\n");
+                }
+                unsigned j = 0;
+                for (const T &value : row) {
+                    m_data[i * C + j++] = value;
+                }
+                ++i;
+            }
+        }
+
+        /*!
+            \brief Конструктор для столбцов: v = {1, 2, 3}
+            @param lst
+         */
+        template<unsigned cols = C, class = typename std::enable_if<cols == 1>::type>
+        constexpr FixedMatrix(std::initializer_list<T> lst) : m_data{} {
+            if (lst.size() != R) {
+                throw std::logic_error("matrix dimensions are not matching\n");
+            }
+            unsigned i = 0;
+            for (const T &value : lst) {
+                m_data[i++] = value;
+            }
+        }
+
+        /*!
+            \brief Копия динамической матрицы того же размера
+            @param other
+         */
+        explicit FixedMatrix(const Matrix<T> &other) : m_data{} {
+            if (other.rows() != R || other.cols() != C) {
+                throw std::logic_error("matrix dimensions are not matching\n");
+            }
+            for (unsigned i = 0; i < R * C; ++i) {
+                m_data[i] = other.data()[i];
+            }
+        }
+
+        /*!
+            \brief Единичная матрица
+         */
+        static constexpr FixedMatrix identity() {
+            static_assert(R == C, "identity matrix must be square");
+            FixedMatrix result;
+            for (unsigned i = 0; i < R; ++i) {
+                result.m_data[i * C + i] = T(1);
+            }
+            return result;
+        }
+
+        static constexpr unsigned rows() { return R; }
+
+        static constexpr unsigned cols() { return C; }
+
+        constexpr T *data() { return m_data; }
+
+        constexpr const T *data() const { return m_data; }
+
+        /*!
+            \brief Доступ к элементам через круглые скобки
+            @param i, j
+         */
+        constexpr T &operator()(unsigned i, unsigned j) {
+            if (i >= R || j >= C) {
+                throw std::logic_error("index out of range\n");
+            }
+            return m_data[i * C + j];
+        }
+
+        constexpr const T &operator()(unsigned i, unsigned j) const {
+            if (i >= R || j >= C) {
+                throw std::logic_error("index out of range\n");
+            }
+            return m_data[i * C + j];
+        }
+
+        // арифметические операции
+        constexpr FixedMatrix &operator+=(const FixedMatrix &rhs) {
+            for (unsigned i = 0; i < R * C; ++i) {
+                m_data[i] += rhs.m_data[i];
+            }
+            return *this;
+        }
+
+        constexpr FixedMatrix &operator-=(const FixedMatrix &rhs) {
+            for (unsigned i = 0; i < R * C; ++i) {
+                m_data[i] -= rhs.m_data[i];
+            }
+            return *this;
+        }
+
+        constexpr FixedMatrix &operator*=(const T &k) {
+            for (unsigned i = 0; i < R * C; ++i) {
+                m_data[i] *= k;
+            }
+            return *this;
+        }
+
+        // точные перегрузки: выигрывают у ленивых шаблонов из MatrixExpression.h и сразу дают FixedMatrix
+        friend constexpr FixedMatrix operator+(FixedMatrix lhs, const FixedMatrix &rhs) {
+            lhs += rhs;
+            return lhs;
+        }
+
+        friend constexpr FixedMatrix operator-(FixedMatrix lhs, const FixedMatrix &rhs) {
+            lhs -= rhs;
+            return lhs;
+        }
+
+        friend constexpr FixedMatrix operator-(FixedMatrix m) {
+            for (unsigned i = 0; i < R * C; ++i) {
+                m.m_data[i] = -m.m_data[i];
+            }
+            return m;
+        }
+
+        friend constexpr FixedMatrix operator*(const T &k, FixedMatrix m) {
+            m *= k;
+            return m;
+        }
+
+        friend constexpr FixedMatrix operator*(FixedMatrix m, const T &k) {
+            m *= k;
+            return m;
+        }
+
+        friend constexpr bool operator==(const FixedMatrix &lhs, const FixedMatrix &rhs) {
+            for (unsigned i = 0; i < R * C; ++i) {
+                if (!(lhs.m_data[i] == rhs.m_data[i])) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        friend constexpr bool operator!=(const FixedMatrix &lhs, const FixedMatrix &rhs) {
+            return !(lhs == rhs);
+        }
+
+        // транспонирование матрицы
+        friend constexpr FixedMatrix<T, C, R> transpose(const FixedMatrix &m) {
+            FixedMatrix<T, C, R> result;
+            for (unsigned i = 0; i < R; ++i) {
+                for (unsigned j = 0; j < C; ++j) {
+                    result(j, i) = m.m_data[i * C + j];
+                }
+            }
+            return result;
+        }
+
+        // след матрицы
+        constexpr T trace() const {
+            T tr = 0;
+            for (unsigned i = 0; i < (R < C ? R : C); ++i) {
+                tr += m_data[i * C + i];
+            }
+            return tr;
+        }
+
+        /*!
+            \brief Матрица без строки p и столбца q
+         */
+        constexpr FixedMatrix<T, R - 1, C - 1> submatrix(unsigned p, unsigned q) const {
+            FixedMatrix<T, R - 1, C - 1> result;
+            for (unsigned i = 0, row = 0; i < R; ++i) {
+                if (i == p) {
+                    continue;
+                }
+                for (unsigned j = 0, col = 0; j < C; ++j) {
+                    if (j != q) {
+                        result(row, col++) = m_data[i * C + j];
+                    }
+                }
+                ++row;
+            }
+            return result;
+        }
+
+        /*!
+            \brief Определитель
+            \details До 3 x 3 - явные формулы, дальше - разложение по первой строке. Вычисления точные для целых T;
+            для больших матриц быстрее Matrix::det() (LU-разложение).
+         */
+        constexpr T det() const {
+            static_assert(R == C, "not a square matrix");
+            if constexpr (R == 1) {
+                return m_data[0];
+            } else if constexpr (R == 2) {
+                return m_data[0] * m_data[3] - m_data[1] * m_data[2];
+            } else if constexpr (R == 3) {
+                return m_data[0] * (m_data[4] * m_data[8] - m_data[5] * m_data[7])
+                       - m_data[1] * (m_data[3] * m_data[8] - m_data[5] * m_data[6])
+                       + m_data[2] * (m_data[3] * m_data[7] - m_data[4] * m_data[6]);
+            } else {
+                T result = 0;
+                for (unsigned j = 0; j < C; ++j) {
+                    T term = m_data[j] * submatrix(0, j).det();
+                    result += j % 2 == 0 ? term : -term;
+                }
+                return result;
+            }
+        }
+
+        // взаимодействие с потоком вывода и оператором <<
+        friend std::ostream &operator<<(std::ostream &out, const FixedMatrix &m) {
+            for (unsigned i = 0; i < R; ++i) {
+                out << '|';
+                for (unsigned j = 0; j < C; ++j) {
+                    out << std::scientific << std::setprecision(4) << " " << std::right << std::setw(7) << m(i, j);
+                    if (j != C - 1) {
+                        out << " ";
+                    }
+                }
+                out << "|\n";
+            }
+            return out;
+        }
+    };
+
+    /*!
+        \brief Произведение матриц фиксированного размера
+        @param lhs - R x K
+        @param rhs - K x C
+        @return R x C
+     */
+    template<class T, unsigned R, unsigned K, unsigned C>
+    constexpr FixedMatrix<T, R, C> operator*(const FixedMatrix<T, R, K> &lhs, const FixedMatrix<T, K, C> &rhs) {
+        FixedMatrix<T, R, C> result;
+        T *c = result.data();
+        const T *a = lhs.data(), *b = rhs.data();
+        for (unsigned i = 0; i < R; ++i) {
+            for (unsigned k = 0; k < K; ++k) {
+                for (unsigned j = 0; j < C; ++j) {
+                    c[i * C + j] += a[i * K + k] * b[k * C + j];
+                }
+            }
+        }
+        return result;
+    }
+
+    /*!
+        \brief Обратная матрица через присоединённую: A^-1 = adj(A) / det(A)
+        \details Для малых размеров (до 4 x 4) это быстрее и точнее общего LU; для целых T результат в double.
+        Для больших матриц - linalg::inverse(Matrix).
+        @param m
+     */
+    template<class T, unsigned N>
+    constexpr FixedMatrix<typename linalg_detail::lu_value<T>::type, N, N> inverse(const FixedMatrix<T, N, N> &m) {
+        typedef typename linalg_detail::lu_value<T>::type value_type;
+        FixedMatrix<value_type, N, N> result;
+
+        value_type d = value_type(m.det());
+        if (d == value_type(0)) {
+            throw std::logic_error("matrix is singular\n");
+        }
+
+        if constexpr (N == 1) {
+            result(0, 0) = value_type(1) / d;
+        } else {
+            for (unsigned i = 0; i < N; ++i) {
+                for (unsigned j = 0; j < N; ++j) {
+                    value_type cofactor = value_type(m.submatrix(j, i).det());
+                    result(i, j) = ((i + j) % 2 == 0 ? cofactor : -cofactor) / d;
+                }
+            }
+        }
+        return result;
+    }
+}
@@ -0,0 +1,252 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <type_traits>
+#include <cstddef>
+#include "ThreadPool.h"
+
+/*!
+ \brief Вспомогательные функции линейной алгебры (не для прямого использования)
+*/
+namespace linalg_detail {
+    /*!
+     * \brief Параметры блочного умножения для типа T
+     * \details mr x nr - блок C, который микроядро держит в регистрах; kc, mc, nc - размеры блоков A и B,
+     * подобранные так, чтобы упакованная панель B (kc x nr) жила в L1, блок A (mc x kc) - в L2, блок B (kc x nc) - в L3.
+     */
+    template<class T>
+    struct GemmBlocking {
+        static constexpr size_t mr = 8, nr = 4;
+        static constexpr size_t kc = 256, mc = 128, nc = 2048;
+    };
+
+    template<>
+    struct GemmBlocking<float> {
+        static constexpr size_t mr = 4, nr = 8;
+        static constexpr size_t kc = 256, mc = 128, nc = 4096;
+    };
+
+    template<class T>
+    struct is_packed_gemm : std::integral_constant<bool, std::is_same<T, float>::value || std::is_same<T, double>::value> {};
+
+    /*!
+     * \brief Упаковка блока A (mc x kc) в панели по mr строк: внутри панели элементы идут по столбцам
+     * \details Недостающие строки последней панели заполняются нулями, чтобы микроядро не проверяло края.
+     */
+    template<class T>
+    void pack_a(size_t mc, size_t kc, const T *a, ptrdiff_t row_stride, ptrdiff_t col_stride, T *packed) {
+        constexpr size_t mr = GemmBlocking<T>::mr;
+        for (size_t i0 = 0; i0 < mc; i0 += mr) {
+            size_t rows = std::min(mr, mc - i0);
+            for (size_t p = 0; p < kc; ++p) {
+                for (size_t i = 0; i < rows; ++i) {
+                    *packed++ = a[ptrdiff_t(i0 + i) * row_stride + ptrdiff_t(p) * col_stride];
+                }
+                for (size_t i = rows; i < mr; ++i) {
+                    *packed++ = T(0);
+                }
+            }
+        }
+    }
+
+    /*!
+     * \brief Упаковка блока B (kc x nc) в панели по nr столбцов: внутри панели элементы идут по строкам
+     */
+    template<class T>
+    void pack_b(size_t kc, size_t nc, const T *b, ptrdiff_t row_stride, ptrdiff_t col_stride, T *packed) {
+        constexpr size_t nr = GemmBlocking<T>::nr;
+        for (size_t j0 = 0; j0 < nc; j0 += nr) {
+            size_t cols = std::min(nr, nc - j0);
+            for (size_t p = 0; p < kc; ++p) {
+                for (size_t j = 0; j < cols; ++j) {
+                    *packed++ = b[ptrdiff_t(p) * row_stride + ptrdiff_t(j0 + j) * col_stride];
+                }
+                for (size_t j = cols; j < nr; ++j) {
+                    *packed++ = T(0);
+                }
+            }
+        }
+    }
+
+    /*!
+     * \brief Микроядро: C[0..rows, 0..cols] += панель A (mr x kc) * панель B (kc x nr)
+     * \details Блок mr x nr накапливается в локальном массиве фиксированного размера, который компилятор
+     * раскладывает по векторным регистрам; в C пишется только видимая часть блока.
+     */
+    template<class T>
+    void micro_kernel(size_t kc, const T *a, const T *b, T *c, ptrdiff_t c_row_stride, size_t rows, size_t cols) {
+        constexpr size_t mr = GemmBlocking<T>::mr, nr = GemmBlocking<T>::nr;
+        T acc[mr][nr] = {};
+
+        for (size_t p = 0; p < kc; ++p) {
+            for (size_t i = 0; i < mr; ++i) {
+                T a_ip = a[i];
+                for (size_t j = 0; j < nr; ++j) {
+                    acc[i][j] += a_ip * b[j];
+                }
+            }
+            a += mr;
+            b += nr;
+        }
+
+        if (rows == mr && cols == nr) {
+            for (size_t i = 0; i < mr; ++i) {
+                for (size_t j = 0; j < nr; ++j) {
+                    c[ptrdiff_t(i) * c_row_stride + j] += acc[i][j];
+                }
+            }
+        } else {
+            for (size_t i = 0; i < rows; ++i) {
+                for (size_t j = 0; j < cols; ++j) {
+                    c[ptrdiff_t(i) * c_row_stride + j] += acc[i][j];
+                }
+            }
+        }
+    }
+
+    /*!
+     * \brief Блочное умножение с упаковкой: C += A * B для float и double
+     */
+    template<class T>
+    void gemm_packed(size_t m, size_t n, size_t k,
+                     const T *a, ptrdiff_t a_row_stride, ptrdiff_t a_col_stride,
+                     const T *b, ptrdiff_t b_row_stride, ptrdiff_t b_col_stride,
+                     T *c, ptrdiff_t c_row_stride) {
+        typedef GemmBlocking<T> blocking;
+        constexpr size_t mr = blocking::mr, nr = blocking::nr;
+
+        std::vector<T> packed_a((std::min(m, blocking::mc) + mr - 1) / mr * mr * std::min(k, blocking::kc));
+        std::vector<T> packed_b((std::min(n, blocking::nc) + nr - 1) / nr * nr * std::min(k, blocking::kc));
+
+        for (size_t jc = 0; jc < n; jc += blocking::nc) {
+            size_t nc = std::min(blocking::nc, n - jc);
+            for (size_t pc = 0; pc < k; pc += blocking::kc) {
+                size_t kc = std::min(blocking::kc, k - pc);
+                pack_b(kc, nc, b + ptrdiff_t(pc) * b_row_stride + ptrdiff_t(jc) * b_col_stride, b_row_stride, b_col_stride, packed_b.data());
+
+                for (size_t ic = 0; ic < m; ic += blocking::mc) {
+                    size_t mc = std::min(blocking::mc, m - ic);
+                    pack_a(mc, kc, a + ptrdiff_t(ic) * a_row_stride + ptrdiff_t(pc) * a_col_stride, a_row_stride, a_col_stride, packed_a.data());
+
+                    for (size_t jr = 0; jr < nc; jr += nr) {
+                        for (size_t ir = 0; ir < mc; ir += mr) {
+                            micro_kernel(kc, packed_a.data() + ir * kc, packed_b.data() + jr * kc,
+                                         c + ptrdiff_t(ic + ir) * c_row_stride + ptrdiff_t(jc + jr), c_row_stride,
+                                         std::min(mr, mc - ir), std::min(nr, nc - jr));
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    /*!
+     * \brief Умножение для остальных типов (целые, Complex): порядок i-k-j, строки B и C читаются подряд
+     */
+    template<class T>
+    void gemm_generic(size_t m, size_t n, size_t k,
+                      const T *a, ptrdiff_t a_row_stride, ptrdiff_t a_col_stride,
+                      const T *b, ptrdiff_t b_row_stride, ptrdiff_t b_col_stride,
+                      T *c, ptrdiff_t c_row_stride) {
+        for (size_t i = 0; i < m; ++i) {
+            T *c_row = c + ptrdiff_t(i) * c_row_stride;
+            for (size_t p = 0; p < k; ++p) {
+                T a_ip = a[ptrdiff_t(i) * a_row_stride + ptrdiff_t(p) * a_col_stride];
+                const T *b_row = b + ptrdiff_t(p) * b_row_stride;
+                for (size_t j = 0; j < n; ++j) {
+                    c_row[j] += a_ip * b_row[ptrdiff_t(j) * b_col_stride];
+                }
+            }
+        }
+    }
+
+    /*!
+     * \brief C += A * B, матрицы заданы указателем на первый элемент и шагами по строкам и столбцам
+     * \details Шаги позволяют передавать подматрицы и транспонированные матрицы без копирования.
+     * C хранится по строкам (шаг по столбцам равен 1).
+     * @param m, n, k - A имеет размер m x k, B - k x n, C - m x n
+     */
+    template<class T>
+    void gemm(size_t m, size_t n, size_t k,
+              const T *a, ptrdiff_t a_row_stride, ptrdiff_t a_col_stride,
+              const T *b, ptrdiff_t b_row_stride, ptrdiff_t b_col_stride,
+              T *c, ptrdiff_t c_row_stride) {
+        if (m == 0 || n == 0 || k == 0) {
+            return;
+        }
+        if constexpr (is_packed_gemm<T>::value) {
+            gemm_packed(m, n, k, a, a_row_stride, a_col_stride, b, b_row_stride, b_col_stride, c, c_row_stride);
+        } else {
+            gemm_generic(m, n, k, a, a_row_stride, a_col_stride, b, b_row_stride, b_col_stride, c, c_row_stride);
+        }
+    }
+
+    /*!
+     * \brief Меньше стольких умножений gemm выполняется в одном потоке
+     */
+    constexpr size_t gemm_parallel_threshold = size_t(1) << 21;
+
+    /*!
+     * \brief C += A * B на общем пуле потоков
+     * \details C делится на плитки по строкам и столбцам, каждая плитка - отдельный вызов gemm() со своей
+     * упаковкой (повторная упаковка B на плитку стоит 1/(строк в плитке) от её умножений). Маленькие произведения
+     * считаются в вызывающем потоке.
+     */
+    template<class T>
+    void parallel_gemm(size_t m, size_t n, size_t k,
+                       const T *a, ptrdiff_t a_row_stride, ptrdiff_t a_col_stride,
+                       const T *b, ptrdiff_t b_row_stride, ptrdiff_t b_col_stride,
+                       T *c, ptrdiff_t c_row_stride) {
+        ThreadPool& pool = ThreadPool::shared();
+        if (pool.size() == 1 || m * n * k < gemm_parallel_threshold) {
+            gemm(m, n, k, a, a_row_stride, a_col_stride, b, b_row_stride, b_col_stride, c, c_row_stride);
+            return;
+        }
+
+        typedef GemmBlocking<T> blocking;
+        const size_t col_tile = 128 * blocking::nr;
+        size_t row_tile = blocking::mc;
+        size_t col_tiles = (n + col_tile - 1) / col_tile;
+        while (row_tile > 2 * blocking::mr && (m + row_tile - 1) / row_tile * col_tiles < 2 * pool.size()) {
+            row_tile /= 2;
+        }
+        size_t row_tiles = (m + row_tile - 1) / row_tile;
+
+        pool.parallel_for(row_tiles * col_tiles, [&](size_t tile, size_t) {
+            size_t i0 = tile / col_tiles * row_tile, j0 = tile % col_tiles * col_tile;
+            gemm(std::min(row_tile, m - i0), std::min(col_tile, n - j0), k,
+                 a + ptrdiff_t(i0) * a_row_stride, a_row_stride, a_col_stride,
+                 b + ptrdiff_t(j0) * b_col_stride, b_row_stride, b_col_stride,
+                 c + ptrdiff_t(i0) * c_row_stride + ptrdiff_t(j0), c_row_stride);
+        });
+    }
+
+    /*!
+     * \brief Меньше стольких элементов поэлементные операции выполняются в одном потоке
+     */
+    constexpr size_t elementwise_parallel_threshold = size_t(1) << 15;
+
+    /*!
+     * \brief Параллельный обход [0, count) кусками: body(begin, end)
+     * \details Если элементов матрицы (count * item_size) меньше порога, весь диапазон обрабатывается
+     * одним вызовом в вызывающем потоке.
+     * @param count
+     * @param grain - длина куска
+     * @param body
+     * @param item_size - сколько элементов матрицы приходится на одну позицию диапазона (например, длина строки)
+     */
+    template<class body_t>
+    void parallel_chunks(size_t count, size_t grain, const body_t& body, size_t item_size = 1) {
+        ThreadPool& pool = ThreadPool::shared();
+        if (pool.size() == 1 || count * item_size < elementwise_parallel_threshold) {
+            body(size_t(0), count);
+            return;
+        }
+
+        size_t chunks = (count + grain - 1) / grain;
+        pool.parallel_for(chunks, [&](size_t chunk, size_t) {
+            body(chunk * grain, std::min(count, (chunk + 1) * grain));
+        });
+    }
+}
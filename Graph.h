@@ -1,7 +1,97 @@
 #pragma once
 
 #include <map>
+#include <set>
+#include <memory>
+#include <unordered_map>
+#include <functional>
+#include <type_traits>
+#include <vector>
 #include <limits>
+#include <algorithm>
+#include <stdexcept>
+#include <cstdint>
+#include <cmath>
+#include <atomic>
+#include <optional>
+#include <iterator>
+#include "Heap.h"
+#include "CsrGraph.h"
+#include "ThreadPool.h"
+#include "Matrix.h"
+
+namespace graph_detail {
+    /*!
+     * \brief Проверка, есть ли для типа ключа std::hash
+     */
+    template<typename key_type, typename = void>
+    struct is_hashable : std::false_type {};
+
+    template<typename key_type>
+    struct is_hashable<key_type, std::void_t<decltype(std::hash<key_type>()(std::declval<const key_type&>()))>>
+            : std::true_type {};
+
+    /*!
+     * \brief Хеш-таблица ключ -> номер узла
+     * \details Хранит указатели на ключи, которыми владеет граф, поэтому строки не копируются.
+     * Для ключей без std::hash таблица пустая (enabled == false), и граф ищет узлы в своём std::map.
+     * @tparam key_type
+     */
+    template<typename key_type, bool hashed = is_hashable<key_type>::value>
+    class KeyIndex {
+        struct key_hash {
+            size_t operator()(const key_type* key) const { return std::hash<key_type>()(*key); }
+        };
+        struct key_equal {
+            bool operator()(const key_type* lhs, const key_type* rhs) const { return *lhs == *rhs; }
+        };
+
+        std::unordered_map<const key_type*, uint32_t, key_hash, key_equal> ids;
+
+    public:
+        static constexpr bool enabled = true;
+        static constexpr uint32_t npos = std::numeric_limits<uint32_t>::max();
+
+        uint32_t find(const key_type& key) const {
+            auto it = ids.find(&key);
+            return it == ids.end() ? npos : it->second;
+        }
+        void assign(const key_type& key, uint32_t id) {
+            ids.insert_or_assign(&key, id);
+        }
+        void erase(const key_type& key) {
+            ids.erase(&key);
+        }
+        void clear() {
+            ids.clear();
+        }
+    };
+
+    template<typename key_type>
+    class KeyIndex<key_type, false> {
+    public:
+        static constexpr bool enabled = false;
+        static constexpr uint32_t npos = std::numeric_limits<uint32_t>::max();
+
+        uint32_t find(const key_type&) const { return npos; }
+        void assign(const key_type&, uint32_t) {}
+        void erase(const key_type&) {}
+        void clear() {}
+    };
+
+    /*!
+     * \brief Удаление номера из списка номеров (порядок списка не сохраняется)
+     * @param list
+     * @param id
+     */
+    inline void erase_id(std::vector<uint32_t>& list, uint32_t id) {
+        auto it = std::find(list.begin(), list.end(), id);
+        if (it != list.end()) {
+            *it = list.back();
+            list.pop_back();
+        }
+    }
+}
 
 /*!
  * \brief Шаблонный класс графа
@@ -11,51 +101,327 @@
  */
 template<typename key_type, typename value_type, typename weight_type>
 class Graph {
+    /*!
+     * \brief Индекс входящих рёбер: по плотному номеру узла - номера узлов, из которых в него идут рёбра
+     */
+    typedef std::vector<std::vector<uint32_t>> in_edge_index;
+
+    /*!
+     * \brief Рёбра узла: плотный номер узла, куда идёт ребро -> вес
+     */
+    typedef std::map<uint32_t, weight_type> edge_map;
+
+    /*!
+     * \brief Рёбра узла вне графа: ключ узла, куда идёт ребро -> вес
+     */
+    typedef std::map<key_type, weight_type> key_edge_map;
+
+    /*!
+     * \brief Итератор по рёбрам узла
+     * \details У узла в графе при разыменовании номер узла, куда идёт ребро, заменяется его ключом, и получается пара
+     * (ключ узла, куда идёт ребро; вес ребра). Пара лежит в самом итераторе, поэтому ссылка на неё действует,
+     * пока жив итератор (в range-for - до конца шага цикла). У узла вне графа (owner == nullptr) итератор
+     * идёт по рёбрам, записанным по ключам.
+     * @tparam is_const
+     */
+    template<bool is_const>
+    class edge_iterator {
+        friend class edge_iterator<!is_const>;
+
+        typedef typename std::conditional<is_const, typename edge_map::const_iterator, typename edge_map::iterator>::type base_iterator;
+        typedef typename std::conditional<is_const, typename key_edge_map::const_iterator, typename key_edge_map::iterator>::type key_iterator;
+        typedef typename std::conditional<is_const, const weight_type, weight_type>::type mapped_type;
+
+        const Graph* owner = nullptr;
+        base_iterator it;
+        key_iterator key_it;
+        mutable std::optional<std::pair<const key_type&, mapped_type&>> current;
+
+    public:
+        typedef std::bidirectional_iterator_tag iterator_category;
+        typedef std::pair<const key_type&, mapped_type&>& reference;
+        typedef std::pair<const key_type&, mapped_type&>* pointer;
+        typedef std::ptrdiff_t difference_type;
+
+        edge_iterator() = default;
+        edge_iterator(const Graph* owner, base_iterator it) : owner(owner), it(it) {}
+        explicit edge_iterator(key_iterator key_it) : key_it(key_it) {}
+        edge_iterator(const edge_iterator& other) : owner(other.owner), it(other.it), key_it(other.key_it) {}
+        /*!
+         * \brief Преобразование итератора в константный
+         * @param other
+         */
+        template<bool other_const, typename = typename std::enable_if<is_const && !other_const>::type>
+        edge_iterator(const edge_iterator<other_const>& other) : owner(other.owner), it(other.it), key_it(other.key_it) {}
+
+        edge_iterator& operator=(const edge_iterator& other) {
+            owner = other.owner;
+            it = other.it;
+            key_it = other.key_it;
+            current.reset();
+            return *this;
+        }
+
+        reference operator*() const {
+            if (owner) {
+                current.emplace(owner->nodes_by_id[it->first]->first, it->second);
+            } else {
+                current.emplace(key_it->first, key_it->second);
+            }
+            return *current;
+        }
+        pointer operator->() const {
+            return &**this;
+        }
+        edge_iterator& operator++() {
+            if (owner) {
+                ++it;
+            } else {
+                ++key_it;
+            }
+            return *this;
+        }
+        edge_iterator operator++(int) {
+            edge_iterator tmp = *this;
+            ++*this;
+            return tmp;
+        }
+        edge_iterator& operator--() {
+            if (owner) {
+                --it;
+            } else {
+                --key_it;
+            }
+            return *this;
+        }
+        edge_iterator operator--(int) {
+            edge_iterator tmp = *this;
+            --*this;
+            return tmp;
+        }
+        bool operator==(const edge_iterator& rhs) const { return owner ? it == rhs.it : key_it == rhs.key_it; }
+        bool operator!=(const edge_iterator& rhs) const { return !(*this == rhs); }
+    };
+
     /*!
      * \brief Внутренний класс узла
+     * \details Рёбра хранятся парами (плотный номер узла, куда идёт ребро; вес), без копии ключа, и перебираются
+     * в порядке номеров. Меняются они только через методы узла и графа, поэтому индекс входящих рёбер
+     * всегда совпадает с ними. Узел вне графа (в том числе копия узла графа) хранит рёбра по ключам
+     * и от графа не зависит.
      */
     class Node {
-    public:
+        friend class Graph;
+
+        static constexpr uint32_t npos = std::numeric_limits<uint32_t>::max();
+
+        Graph* owner = nullptr;  // граф, в котором лежит узел (nullptr у узла вне графа)
+        uint32_t node_id = npos; // плотный номер узла в графе (npos у узла вне графа)
+        edge_map edges;          // рёбра узла в графе
+        key_edge_map key_edges;  // рёбра узла вне графа
         value_type val;
-        std::map<key_type, weight_type> edges;
-    //public:
 
+        /*!
+         * \brief Лежит ли узел в графе
+         * @return bool - true, если узел лежит в графе owner, false - иначе.
+         */
+        bool in_graph() const noexcept {
+            return owner && node_id != npos;
+        }
+
+        /*!
+         * \brief Рёбра узла, записанные по ключам (для копии узла вне графа)
+         * @return Рёбра по ключам.
+         */
+        key_edge_map edges_by_key() const {
+            if (!in_graph()) {
+                return key_edges;
+            }
+
+            key_edge_map result;
+            for (const auto& [target, weight] : edges) {
+                result.emplace(owner->nodes_by_id[target]->first, weight);
+            }
+            return result;
+        }
+
+        /*!
+         * \brief Индекс входящих рёбер графа (nullptr, если узел вне графа или индекс выключен)
+         * @return Указатель на индекс.
+         */
+        in_edge_index* in_index() const noexcept {
+            return in_graph() ? owner->in_edges.get() : nullptr;
+        }
+
+        /*!
+         * \brief Номер узла графа по ключу
+         * @param key
+         * @return Плотный номер узла.
+         */
+        uint32_t target_id(const key_type& key) const {
+            if (!owner) {
+                throw std::logic_error("node is not in the graph.\n");
+            }
+            return owner->id(key);
+        }
+
+        /*!
+         * \brief Номер узла графа по ключу (npos, если такого узла нет)
+         * @param key
+         * @return Плотный номер узла.
+         */
+        uint32_t find_id(const key_type& key) const {
+            if (!owner) {
+                return npos;
+            }
+            auto it = owner->find_node(key);
+            return it == owner->graph.end() ? npos : it->second.node_id;
+        }
+
+        /*!
+         * \brief Запись только что вставленного ребра в индекс входящих рёбер
+         * \details Если записать не удалось, ребро удаляется.
+         * @param it
+         */
+        void link(typename edge_map::iterator it) {
+            if (in_edge_index* index = in_index()) {
+                try {
+                    (*index)[it->first].push_back(node_id);
+                } catch (...) {
+                    edges.erase(it);
+                    throw;
+                }
+            }
+        }
+
+        /*!
+         * \brief Удаление ребра из индекса входящих рёбер
+         * @param target
+         */
+        void unlink(uint32_t target) {
+            if (in_edge_index* index = in_index()) {
+                graph_detail::erase_id((*index)[target], node_id);
+            }
+        }
+
+        /*!
+         * \brief Вставка ребра по номеру узла, куда оно идёт
+         * @param target
+         * @param weight
+         * @param assign - переприсваивать ли вес существующего ребра
+         * @return Значение std::pair<iterator, bool> по рёбрам узла.
+         */
+        std::pair<typename edge_map::iterator, bool> insert_id(uint32_t target, const weight_type& weight, bool assign) {
+            auto result = assign ? edges.insert_or_assign(target, weight) : edges.insert(std::make_pair(target, weight));
+            if (result.second) {
+                link(result.first);
+            }
+            return result;
+        }
+
+        /*!
+         * \brief Замена номера в ребре (узел с номером from получил номер to), без выделения памяти
+         * @param from
+         * @param to
+         */
+        void renumber(uint32_t from, uint32_t to) {
+            auto handle = edges.extract(from);
+            if (!handle.empty()) {
+                handle.key() = to;
+                edges.insert(std::move(handle));
+            }
+        }
+
+        /*!
+         * \brief Замена рёбер узла рёбрами другого узла с поддержкой индекса
+         * \details Рёбра узла из того же графа переносятся по номерам, из другого графа или вне графа - по ключам.
+         * @param other
+         */
+        void assign_edges(const Node& other) {
+            if (other.owner == owner && !in_index()) {
+                edges = other.edges;
+                return;
+            }
+
+            clear();
+            if (other.owner == owner) {
+                for (const auto& [target, weight] : other.edges) {
+                    insert_id(target, weight, false);
+                }
+            } else {
+                for (const auto& [key, weight] : other) {
+                    insert_id(target_id(key), weight, false);
+                }
+            }
+        }
+
+    public:
         /*!
          * \brief Дефолтный конструктор
          */
         Node() = default;
         /*!
-         * \brief Конструктор копирования
+         * \brief Конструктор копирования (копия не привязана к графу)
+         * \details Рёбра узла графа переводятся в ключи, поэтому копия не зависит от графа и переживает его изменения.
          * @param other
          */
-        Node(const Node& other) = default;
+        Node(const Node& other) : key_edges(other.edges_by_key()), val(other.val) {}
         /*!
-         * \brief Конструктор перемещения
+         * \brief Конструктор перемещения (результат не привязан к графу)
+         * \details Рёбра узла графа переводятся в ключи и удаляются из него (вместе с записями в индексе),
+         * рёбра узла вне графа перемещаются без копирования.
          * @param other
          */
-        Node(Node&& other)  noexcept = default;
+        Node(Node&& other) : key_edges(other.in_graph() ? other.edges_by_key() : std::move(other.key_edges)),
+                             val(std::move(other.val)) {
+            other.clear();
+        }
 
         /*!
          * \brief Конструктор для значения в узле
          * @param other
          */
-        Node(const value_type& other) {
-            val = other;
-        }
+        Node(const value_type& other) : val(other) {}
 
         /*!
          * \brief Оператор копирующего присваивания
          * @param rhs
          * @return Узел после присваивания
          */
-        Node& operator=(const Node& rhs) = default;
+        Node& operator=(const Node& rhs) {
+            if (this == &rhs) {
+                return *this;
+            }
+
+            val = rhs.val;
+            if (in_graph()) {
+                assign_edges(rhs);
+            } else {
+                key_edges = rhs.edges_by_key();
+            }
+            return *this;
+        }
 
         /*!
          * \brief Оператор перемещающего присваивания
+         * \details Рёбра перемещаются, если оба узла лежат вне графа или в одном графе без индекса входящих рёбер,
+         * иначе - копируются (с выделением памяти).
          * @param rhs
          * @return Узел после присваивания
          */
-        Node& operator=(Node&& rhs)  noexcept = default;
+        Node& operator=(Node&& rhs) {
+            if (this == &rhs) {
+                return *this;
+            }
+            if (in_index() || in_graph() != rhs.in_graph() || rhs.owner != owner) {
+                return *this = static_cast<const Node&>(rhs);
+            }
+
+            val = std::move(rhs.val);
+            edges = std::move(rhs.edges);
+            key_edges = std::move(rhs.key_edges);
+            return *this;
+        }
 
         /*!
          * \brief Оператор присваивания для значения в узле
@@ -68,19 +434,27 @@ class Graph {
         }
 
 
+        /*!
+         * \brief Плотный номер узла в графе
+         * @return Номер узла из [0, size() графа) (у копии узла вне графа - std::numeric_limits<uint32_t>::max()).
+         */
+        uint32_t id() const noexcept {
+            return node_id;
+        }
+
         /*!
          * \brief Проверка на пустоту узла
          * @return bool - true если узел пустой, false - иначе.
          */
         bool empty() const {
-            return edges.empty();
+            return edges.empty() && key_edges.empty();
         }
         /*!
          * \brief Количество исходящих рёбер
          * @return Количество исходящих из узла рёбер
          */
         size_t size() const {
-            return edges.size();
+            return edges.size() + key_edges.size();
         }
         /*!
          * \brief Значение в узле
@@ -100,59 +474,65 @@ class Graph {
          * \brief Удаление исходящих рёбер
          */
         void clear() {
+            if (in_edge_index* index = in_index()) {
+                for (const auto& [target, weight] : edges) {
+                    graph_detail::erase_id((*index)[target], node_id);
+                }
+            }
             edges.clear();
+            key_edges.clear();
         }
 
         /*!
          * \brief Псевдоним для итератора узла
          */
-        typedef typename std::map<key_type, weight_type>::iterator iterator;
+        typedef edge_iterator<false> iterator;
         /*!
          * \brief Псевдоним для константного итератора узла
          */
-        typedef typename std::map<key_type, weight_type>::const_iterator const_iterator;
+        typedef edge_iterator<true> const_iterator;
 
         /*!
          * \brief Итератор begin
          * @return Итератор, показывающий на первый элемент узла.
          */
         iterator begin() noexcept {
-            return edges.begin();
+            return in_graph() ? iterator(owner, edges.begin()) : iterator(key_edges.begin());
         }
         /*!
          * \brief Итератор end
          * @return Итератор, показывающий на элемент, следующий за последним элементом узла.
          */
         iterator end() noexcept {
-            return edges.end();
+            return in_graph() ? iterator(owner, edges.end()) : iterator(key_edges.end());
         }
         /*!
          * \brief Итератор begin (const версия)
          * @return Константный итератор, показывающий на первый элемент узла.
          */
         const_iterator begin() const noexcept {
-            return edges.begin();
+            return in_graph() ? const_iterator(owner, edges.begin()) : const_iterator(key_edges.begin());
         }
         /*!
          * \brief Итератор end (const версия)
          * @return Константный итератор, показывающий на элемент, следующий за последним элементом узла.
          */
         const_iterator end() const noexcept {
-            return edges.end();
+            return in_graph() ? const_iterator(owner, edges.end()) : const_iterator(key_edges.end());
         }
         /*!
          * \brief Итератор cbegin
          * @return Константный итератор, показывающий на первый элемент узла.
          */
         const_iterator cbegin() const noexcept {
-            return edges.cbegin();
+            return begin();
         }
         /*!
          * \brief Итератор cend
          * @return Константный итератор, показывающий на элемент, следующий за последним элементом узла.
          */
         const_iterator cend() const noexcept {
-            return edges.cend();
+            return end();
         }
 
         /*!
@@ -161,7 +541,15 @@ class Graph {
          * @return Вес соответствующего ребра.
          */
         weight_type& operator[](key_type key) {
-            return edges[key];
+            if (!in_graph()) {
+                return key_edges[key];
+            }
+
+            auto [it, flag] = edges.try_emplace(target_id(key));
+            if (flag) {
+                link(it);
+            }
+            return it->second;
         }
 
         /*!
@@ -170,7 +558,19 @@ class Graph {
          * @return Вес соответствующего ребра.
          */
         const weight_type& operator[](key_type key) const {
-            return edges[key];
+            if (!in_graph()) {
+                auto it = key_edges.find(key);
+                if (it == key_edges.end()) {
+                    throw std::logic_error("no edge to this key in the node.\n");
+                }
+                return it->second;
+            }
+
+            auto it = edges.find(find_id(key));
+            if (it == edges.end()) {
+                throw std::logic_error("no edge to this key in the node.\n");
+            }
+            return it->second;
         }
 
         /*!
@@ -180,7 +580,13 @@ class Graph {
          * @return Значение std::pair<iterator, bool>, где итератор показывает на элемент узла, откуда идёт ребро, bool - true (если произошла вставка), false - иначе.
          */
         std::pair<iterator, bool> insert_edge(key_type key, weight_type weight) {
-            return edges.insert(std::make_pair(key, weight));
+            if (!in_graph()) {
+                auto [it, flag] = key_edges.insert(std::make_pair(key, weight));
+                return std::pair<iterator, bool>(iterator(it), flag);
+            }
+
+            auto [it, flag] = insert_id(target_id(key), weight, false);
+            return std::pair<iterator, bool>(iterator(owner, it), flag);
         }
 
         /*!
@@ -190,7 +596,13 @@ class Graph {
          * @return Значение std::pair<iterator, bool>, где итератор показывает на элемент узла, откуда идёт ребро, bool - true (если произошла вставка), false - иначе.
          */
         std::pair<iterator, bool> insert_or_assign_edge(key_type key, weight_type weight) {
-            return edges.insert_or_assign(key, weight);
+            if (!in_graph()) {
+                auto [it, flag] = key_edges.insert_or_assign(key, weight);
+                return std::pair<iterator, bool>(iterator(it), flag);
+            }
+
+            auto [it, flag] = insert_id(target_id(key), weight, true);
+            return std::pair<iterator, bool>(iterator(owner, it), flag);
         }
 
         /*!
@@ -199,47 +611,196 @@ class Graph {
          * @return bool - false если такого ребра нет, true - иначе.
          */
         bool erase_edge(key_type key) {
-            if (edges.find(key) == edges.end()) {
+            if (!in_graph()) {
+                return key_edges.erase(key) != 0;
+            }
+
+            auto it = edges.find(find_id(key));
+            if (it == edges.end()) {
                 return false;
             }
 
-            edges.erase(key);
+            uint32_t target = it->first;
+            edges.erase(it);
+            unlink(target);
             return true;
         }
 
     };
 
+    typedef typename std::map<key_type, Node>::iterator node_handle;
+
     std::map<key_type, Node> graph;
+    std::unique_ptr<in_edge_index> in_edges; // nullptr, если индекс входящих рёбер выключен
+    std::vector<node_handle> nodes_by_id;    // nodes_by_id[id] - узел с плотным номером id
+    graph_detail::KeyIndex<key_type> ids;    // ключ -> плотный номер
+
+    /*!
+     * \brief Привязка узла к графу
+     * @param it
+     */
+    void bind(node_handle it) noexcept {
+        it->second.owner = this;
+    }
+
+    /*!
+     * \brief Регистрация нового узла: привязка и выдача следующего плотного номера
+     * @param it
+     */
+    void attach(node_handle it) {
+        bind(it);
+        it->second.node_id = static_cast<uint32_t>(nodes_by_id.size());
+        nodes_by_id.push_back(it);
+        ids.assign(it->first, it->second.node_id);
+        if (in_edges) {
+            in_edges->emplace_back();
+        }
+    }
+
+    /*!
+     * \brief Освобождение номера удаляемого узла: на его место встаёт узел с последним номером
+     * \details В удаляемый узел уже не должно идти рёбер. Номер last переписывается в рёбрах, которые в него ведут:
+     * с индексом - только у узлов из его списка, без индекса - у всех узлов.
+     * @param it
+     */
+    void detach(node_handle it) {
+        uint32_t id = it->second.node_id;
+        uint32_t last = static_cast<uint32_t>(nodes_by_id.size() - 1);
+        if (id != last) {
+            if (in_edges) {
+                for (uint32_t source : (*in_edges)[last]) {
+                    nodes_by_id[source]->second.renumber(last, id);
+                }
+                // в списках узлов, куда ведут рёбра из last, номер тоже меняется (петля уже записана как id)
+                for (const auto& [target, weight] : nodes_by_id[last]->second.edges) {
+                    auto& sources = (*in_edges)[target == id ? last : target];
+                    std::replace(sources.begin(), sources.end(), last, id);
+                }
+                (*in_edges)[id] = std::move((*in_edges)[last]);
+            } else {
+                for (auto& [node_key, node] : graph) {
+                    node.renumber(last, id);
+                }
+            }
+        }
+        if (in_edges) {
+            in_edges->pop_back();
+        }
+
+        ids.erase(it->first);
+        nodes_by_id[id] = nodes_by_id.back();
+        nodes_by_id.pop_back();
+        if (id < nodes_by_id.size()) {
+            nodes_by_id[id]->second.node_id = id;
+            ids.assign(nodes_by_id[id]->first, id);
+        }
+    }
+
+    /*!
+     * \brief Поиск узла (через хеш-таблицу номеров, если ключ хешируемый)
+     * @param key
+     * @return Итератор на узел или graph.end().
+     */
+    node_handle find_node(const key_type& key) {
+        if constexpr (graph_detail::KeyIndex<key_type>::enabled) {
+            uint32_t id = ids.find(key);
+            return id == ids.npos ? graph.end() : nodes_by_id[id];
+        } else {
+            return graph.find(key);
+        }
+    }
+
+    /*!
+     * \brief Поиск узла (const версия)
+     * @param key
+     * @return Итератор на узел или graph.end().
+     */
+    typename std::map<key_type, Node>::const_iterator find_node(const key_type& key) const {
+        if constexpr (graph_detail::KeyIndex<key_type>::enabled) {
+            uint32_t id = ids.find(key);
+            return id == ids.npos ? graph.cend() : typename std::map<key_type, Node>::const_iterator(nodes_by_id[id]);
+        } else {
+            return graph.find(key);
+        }
+    }
 
 public:
     /*!
      * \brief Дефолтный конструктор
      */
     Graph() = default;
+    /*!
+     * \brief Конструктор с выбором индекса входящих рёбер
+     * \details С индексом degree_in() работает без обхода графа, а erase_edges_go_to() и erase_node()
+     * стоят O(число входящих + число исходящих рёбер), зато вставка и удаление рёбер обновляют индекс.
+     * @param track_in_edges
+     */
+    explicit Graph(bool track_in_edges) {
+        if (track_in_edges) {
+            in_edges = std::make_unique<in_edge_index>();
+        }
+    }
     /*!
      * \brief Конструктор копирования
      * @param other
      */
-    Graph(const Graph<key_type, value_type, weight_type>& other) = default;
+    Graph(const Graph<key_type, value_type, weight_type>& other) : nodes_by_id(other.nodes_by_id.size()) {
+        if (other.in_edges) {
+            in_edges = std::make_unique<in_edge_index>(*other.in_edges);
+        }
+        // рёбра переносятся по номерам: копия узла через Node(const Node&) перевела бы их в ключи
+        for (const auto& [key, node] : other.graph) {
+            auto it = graph.emplace_hint(graph.end(), key, node.val);
+            it->second.edges = node.edges;
+            bind(it);
+            it->second.node_id = node.node_id;
+            nodes_by_id[it->second.node_id] = it;
+            ids.assign(it->first, it->second.node_id);
+        }
+    }
     /*!
      * \brief Конструктор перемещения
      * @param other
      */
-    Graph(Graph<key_type, value_type, weight_type>&& other) noexcept = default;
+    Graph(Graph<key_type, value_type, weight_type>&& other) noexcept
+            : graph(std::move(other.graph)), in_edges(std::move(other.in_edges)),
+              nodes_by_id(std::move(other.nodes_by_id)), ids(std::move(other.ids)) {
+        for (auto it = graph.begin(); it != graph.end(); ++it) {
+            bind(it);
+        }
+        other.clear();
+    }
 
     /*!
      * \brief Оператор копирующего присваивания
      * @param rhs
      * @return Граф после присваивания.
      */
-     Graph<key_type, value_type, weight_type>& operator=(const Graph<key_type, value_type, weight_type>& rhs) = default;
+     Graph<key_type, value_type, weight_type>& operator=(const Graph<key_type, value_type, weight_type>& rhs) {
+        if (this != &rhs) {
+            *this = Graph<key_type, value_type, weight_type>(rhs);
+        }
+        return *this;
+    }
 
     /*!
      * \brief Оператор перемещающего присваивания
      * @param rhs
      * @return Граф после присваивания.
      */
-    Graph<key_type, value_type, weight_type>& operator=(Graph<key_type, value_type, weight_type>&& rhs) noexcept = default;
+    Graph<key_type, value_type, weight_type>& operator=(Graph<key_type, value_type, weight_type>&& rhs) noexcept {
+        if (this != &rhs) {
+            graph = std::move(rhs.graph);
+            in_edges = std::move(rhs.in_edges);
+            nodes_by_id = std::move(rhs.nodes_by_id);
+            ids = std::move(rhs.ids);
+            for (auto it = graph.begin(); it != graph.end(); ++it) {
+                bind(it);
+            }
+            rhs.clear();
+        }
+        return *this;
+    }
 
 
 
@@ -262,6 +823,42 @@ public:
      */
     void clear() {
         graph.clear();
+        nodes_by_id.clear();
+        ids.clear();
+        if (in_edges) {
+            in_edges->clear();
+        }
+    }
+
+    /*!
+     * \brief Включён ли индекс входящих рёбер
+     * @return bool - true, если индекс ведётся, false - иначе.
+     */
+    bool tracks_in_edges() const noexcept {
+        return in_edges != nullptr;
+    }
+
+    /*!
+     * \brief Включение или выключение индекса входящих рёбер
+     * \details При включении индекс строится одним проходом по текущим рёбрам.
+     * @param track
+     */
+    void track_in_edges(bool track) {
+        if (track == tracks_in_edges()) {
+            return;
+        }
+        if (!track) {
+            in_edges.reset();
+            return;
+        }
+
+        auto index = std::make_unique<in_edge_index>(nodes_by_id.size());
+        for (const auto& [node_key, node] : graph) {
+            for (const auto& [target, weight] : node.edges) {
+                (*index)[target].push_back(node.node_id);
+            }
+        }
+        in_edges = std::move(index);
     }
     /*!
      * \brief Обмен местами (как метод класса)
@@ -344,14 +941,20 @@ public:
      * @return Степень узла по входящим рёбрам.
      */
     size_t degree_in(key_type key) {
-        if (graph.find(key) == graph.end()) {
+        auto found = find_node(key);
+        if (found == graph.end()) {
             throw std::logic_error("no node with this key in the graph.");
         }
 
+        if (in_edges) {
+            return (*in_edges)[found->second.node_id].size();
+        }
+
         size_t result = 0;
 
+        uint32_t target = found->second.node_id;
         for (auto& [node_key, node] : graph) {
-            if (node.edges.find(key) != node.edges.end()) {
+            if (node.edges.count(target)) {
                 result++;
             }
         }
@@ -364,11 +967,12 @@ public:
      * @return Степень узла по выходящим рёбрам.
      */
     size_t degree_out(key_type key) {
-        if (graph.find(key) == graph.end()) {
+        auto it = find_node(key);
+        if (it == graph.end()) {
             throw std::logic_error("no node with this key in the graph.");
         }
 
-        return graph[key].edges.size();
+        return it->second.edges.size();
     }
     /*!
      * \brief Проверка на наличие петли
@@ -376,11 +980,12 @@ public:
      * @return bool - true, если петля у узла есть, false - иначе.
      */
     bool loop(key_type key) {
-        if (graph.find(key) == graph.end()) {
+        auto it = find_node(key);
+        if (it == graph.end()) {
             throw std::logic_error("no node with this key in the graph.");
         }
 
-        if (graph[key].edges.find(key) != graph[key].edges.end()) {
+        if (it->second.edges.count(it->second.node_id)) {
             return true;
         }
 
@@ -394,12 +999,17 @@ public:
      * @return Узел с таким ключом из графа.
      */
     Node& operator[](key_type key) {
-        if (graph.find(key) == graph.end()) {
-            graph[key] = Node();
-            return graph[key];
+        auto found = find_node(key);
+        if (found != graph.end()) {
+            return found->second;
+        }
+
+        auto [it, flag] = graph.try_emplace(key);
+        if (flag) {
+            attach(it);
         }
 
-        return graph[key];
+        return it->second;
     }
 
     /*!
@@ -408,11 +1018,12 @@ public:
      * @return Узел с таким ключом из графа.
      */
     const Node& operator[](key_type key) const {
-        if (graph.find(key) == graph.end()) {
+        auto it = find_node(key);
+        if (it == graph.end()) {
             throw std::logic_error("no such node in graph.\n");
         }
 
-        return graph.at(key);
+        return it->second;
     }
 
 
@@ -422,11 +1033,54 @@ public:
      * @return Узел с таким ключом из графа.
      */
     Node& at(key_type key) {
-        if (graph.find(key) == graph.end()) {
+        auto it = find_node(key);
+        if (it == graph.end()) {
+            throw std::logic_error("no node with this key in the graph.");
+        }
+
+        return it->second;
+    }
+
+    /*!
+     * \brief Плотный номер узла по ключу
+     * \details Номера узлов идут подряд от 0 до size() - 1. При удалении узла его номер получает узел с последним номером.
+     * @param key
+     * @return Номер узла.
+     */
+    uint32_t id(const key_type& key) const {
+        auto it = find_node(key);
+        if (it == graph.end()) {
             throw std::logic_error("no node with this key in the graph.");
         }
 
-        return graph[key];
+        return it->second.node_id;
+    }
+
+    /*!
+     * \brief Ключ узла по плотному номеру, O(1)
+     * @param id
+     * @return Ключ узла.
+     */
+    const key_type& key(uint32_t id) const {
+        return nodes_by_id.at(id)->first;
+    }
+
+    /*!
+     * \brief Узел по плотному номеру, O(1)
+     * @param id
+     * @return Узел с таким номером.
+     */
+    Node& node(uint32_t id) {
+        return nodes_by_id.at(id)->second;
+    }
+
+    /*!
+     * \brief Узел по плотному номеру, O(1) (const версия)
+     * @param id
+     * @return Узел с таким номером.
+     */
+    const Node& node(uint32_t id) const {
+        return nodes_by_id.at(id)->second;
     }
 
     /*!
@@ -436,9 +1090,18 @@ public:
      * @return Значение std::pair<iterator, bool>, где итератор показывает на элемент графа, bool - true (если произошла вставка), false - иначе.
      */
     std::pair<iterator, bool> insert_node(key_type key, value_type val) {
+        auto found = find_node(key);
+        if (found != graph.end()) {
+            return std::pair<iterator, bool>(found, false);
+        }
+
         Node tmp;
         tmp.value() = val;
-        return graph.emplace(key, tmp);
+        auto result = graph.emplace(key, tmp);
+        if (result.second) {
+            attach(result.first);
+        }
+        return result;
     }
 
     /*!
@@ -448,14 +1111,17 @@ public:
      * @return Значение std::pair<iterator, bool>, где итератор показывает на элемент графа, bool - true (если произошла вставка), false - иначе.
      */
     std::pair<iterator, bool> insert_or_assign_node(key_type key, value_type val) {
-        if (graph.find(key) != graph.end()) {
-            graph[key].value() = val;
-            return std::pair<iterator, bool>(graph.find(key), false);
+        auto found = find_node(key);
+        if (found != graph.end()) {
+            found->second.value() = val;
+            return std::pair<iterator, bool>(found, false);
         }
 
         Node tmp;
         tmp.value() = val;
-        return graph.insert_or_assign(key, tmp);
+        auto result = graph.insert_or_assign(key, tmp);
+        attach(result.first);
+        return result;
     }
 
     /*!
@@ -466,17 +1132,19 @@ public:
      */
     std::pair<iterator, bool> insert_edge(std::pair<key_type, key_type> keys, weight_type weight) {
         key_type key_from = keys.first, key_to = keys.second;
-        if (graph.find(key_from) == graph.end()) {
+        auto from = find_node(key_from);
+        if (from == graph.end()) {
             throw std::logic_error("node referencing to key_from is not in the graph.\n");
         }
 
-        if (graph.find(key_to) == graph.end()) {
+        auto to = find_node(key_to);
+        if (to == graph.end()) {
             throw std::logic_error("node referencing to key_to is not in the graph.\n");
         }
 
-        auto [key, flag] = graph[key_from].insert_edge(key_to, weight);
+        auto [edge, flag] = from->second.insert_id(to->second.node_id, weight, false);
 
-        return std::pair<iterator, bool>(graph.find(key_from), flag);
+        return std::pair<iterator, bool>(from, flag);
     }
 
     /*!
@@ -487,17 +1155,19 @@ public:
      */
     std::pair<iterator, bool> insert_or_assign_edge(std::pair<key_type, key_type> keys, weight_type weight) {
         key_type key_from = keys.first, key_to = keys.second;
-        if (graph.find(key_from) == graph.end()) {
+        auto from = find_node(key_from);
+        if (from == graph.end()) {
             throw std::logic_error("node referencing to key_from is not in the graph.\n");
         }
 
-        if (graph.find(key_to) == graph.end()) {
+        auto to = find_node(key_to);
+        if (to == graph.end()) {
             throw std::logic_error("node referencing to key_to is not in the graph.\n");
         }
 
-        auto [key, flag] = graph[key_from].insert_or_assign_edge(key_to, weight);
+        auto [edge, flag] = from->second.insert_id(to->second.node_id, weight, true);
 
-        return std::pair<iterator, bool>(graph.find(key_from), flag);
+        return std::pair<iterator, bool>(from, flag);
     }
 
     /*!
@@ -507,6 +1177,11 @@ public:
         for (auto& [node_key, node] : graph) {
             node.edges.clear();
         }
+        if (in_edges) {
+            for (auto& sources : *in_edges) {
+                sources.clear();
+            }
+        }
     }
 
     /*!
@@ -515,11 +1190,12 @@ public:
      * @return Значение bool (false - если узел не найден, true - иначе).
      */
     bool erase_edges_go_from(key_type key) {
-        if (graph.find(key) == graph.end()) {
+        auto it = find_node(key);
+        if (it == graph.end()) {
             return false;
         }
 
-        graph[key].clear();
+        it->second.clear();
         return true;
     }
 
@@ -529,12 +1205,22 @@ public:
      * @return Значение bool (false - если узел не найден, true - иначе).
      */
     bool erase_edges_go_to(key_type key) {
-        if (graph.find(key) == graph.end()) {
+        auto found = find_node(key);
+        if (found == graph.end()) {
             return false;
         }
 
-        for (auto& [node_key, node] : graph) {
-            node.erase_edge(key);
+        uint32_t target = found->second.node_id;
+        if (in_edges) {
+            auto& sources = (*in_edges)[target];
+            for (uint32_t source : sources) {
+                nodes_by_id[source]->second.edges.erase(target);
+            }
+            sources.clear();
+        } else {
+            for (auto& [node_key, node] : graph) {
+                node.edges.erase(target);
+            }
         }
         return true;
     }
@@ -545,91 +1231,1706 @@ public:
      * @return Значение bool (true, если узел найден и удалён, false - иначе).
      */
     bool erase_node(key_type key) {
-        if (graph.find(key) == graph.end()) {
+        auto it = find_node(key);
+        if (it == graph.end()) {
             return false;
         }
 
-        for (auto& [node_key, node] : graph) {
-            node.erase_edge(key);
+        erase_edges_go_to(key);
+        it->second.clear();
+        detach(it);
+        graph.erase(it);
+        return true;
+    }
+
+    /*!
+     * \brief Неизменяемый снимок графа в формате CSR
+     * \details Номера в снимке идут в порядке ключей, номера графа переводятся в них через remap; рёбра вершины
+     * упорядочены по номерам снимка, то есть по ключам узлов, куда они идут. Снимок не следит за графом: для серии
+     * запросов к неизменному графу его строят один раз и передают в алгоритмы вместо графа.
+     * @return Снимок с плотной нумерацией вершин и рёбрами в сплошных массивах.
+     */
+    CsrGraph<key_type, value_type, weight_type> freeze() const {
+        std::vector<uint32_t> remap(nodes_by_id.size());
+        std::vector<key_type> keys;
+        std::vector<value_type> values;
+        keys.reserve(graph.size());
+        values.reserve(graph.size());
+        size_t edge_count = 0;
+        for (const auto& [node_key, node] : graph) {
+            remap[node.node_id] = static_cast<uint32_t>(keys.size());
+            keys.push_back(node_key);
+            values.push_back(node.val);
+            edge_count += node.edges.size();
         }
 
-        graph.erase(key);
-        return true;
+        std::vector<size_t> offsets;
+        std::vector<uint32_t> targets;
+        std::vector<weight_type> weights;
+        offsets.reserve(graph.size() + 1);
+        targets.reserve(edge_count);
+        weights.reserve(edge_count);
+        offsets.push_back(0);
+        std::vector<std::pair<uint32_t, const weight_type*>> row;
+        for (const auto& [node_key, node] : graph) {
+            row.clear();
+            for (const auto& [target, weight] : node.edges) {
+                row.emplace_back(remap[target], &weight);
+            }
+            std::sort(row.begin(), row.end(), [](const std::pair<uint32_t, const weight_type*>& a,
+                                                 const std::pair<uint32_t, const weight_type*>& b) {
+                return a.first < b.first;
+            });
+            for (const auto& [target, weight] : row) {
+                targets.push_back(target);
+                weights.push_back(*weight);
+            }
+            offsets.push_back(targets.size());
+        }
+
+        return CsrGraph<key_type, value_type, weight_type>(std::move(keys), std::move(values), std::move(offsets),
+                                                           std::move(targets), std::move(weights));
     }
 
 };
 
-/*!
- * \brief Алгоритм Дейкстры
+namespace graph_detail {
+    /*!
+     * \brief CSR-представление графа для алгоритмов (снимок строится заново)
+     */
+    template<typename key_type, typename value_type, typename weight_type>
+    CsrGraph<key_type, value_type, weight_type> as_csr(const Graph<key_type, value_type, weight_type>& graph) {
+        return graph.freeze();
+    }
+
+    /*!
+     * \brief CSR-представление графа для алгоритмов (снимок уже есть, копирования нет)
+     */
+    template<typename key_type, typename value_type, typename weight_type>
+    const CsrGraph<key_type, value_type, weight_type>& as_csr(const CsrGraph<key_type, value_type, weight_type>& graph) {
+        return graph;
+    }
+
+    /*!
+     * \brief Ключи вершин снимка по номерам (по возрастанию)
+     */
+    template<typename csr_t>
+    auto snapshot_keys(const csr_t& csr) {
+        std::vector<typename std::decay<decltype(csr.key(0))>::type> keys;
+        keys.reserve(csr.size());
+        for (uint32_t v = 0; v < csr.size(); ++v) {
+            keys.push_back(csr.key(v));
+        }
+        return keys;
+    }
+
+    /*!
+     * \brief Номер вершины по ключу в упорядоченном массиве ключей снимка
+     */
+    template<typename key_type>
+    uint32_t key_index(const std::vector<key_type>& keys, const key_type& key) {
+        auto it = std::lower_bound(keys.begin(), keys.end(), key);
+        if (it == keys.end() || key < *it) {
+            throw std::logic_error("no node with this key in the graph.");
+        }
+        return static_cast<uint32_t>(it - keys.begin());
+    }
+}
+
+/*!
+ * \brief Рабочие буферы алгоритма Дейкстры
+ * \details Массивы расстояний и предков по плотным номерам вершин и очередь переживают запрос,
+ * между запросами сбрасываются только затронутые элементы. Один объект на поток.
+ * @tparam weight_t
+ * @tparam queue_t
+ */
+template<typename weight_t, typename queue_t = BinaryHeap<weight_t>>
+class DijkstraWorkspace {
+public:
+    static constexpr weight_t INF = std::numeric_limits<weight_t>::max();
+    static constexpr uint32_t NONE = std::numeric_limits<uint32_t>::max();
+
+    std::vector<weight_t> d;          // d[v]
+    std::vector<uint32_t> route_tmp;  // route_tmp[v] - предыдущая вершина на кратчайшем пути или NONE
+    std::vector<char> used;           // used[v] = true/false
+    std::vector<uint32_t> touched;    // вершины, у которых менялись d/route_tmp/used
+    queue_t queue;
+
+    /*!
+     * \brief Подготовка буферов к запросу на графе с n вершинами
+     * @param n
+     */
+    void prepare(size_t n) {
+        if (d.size() != n) {
+            d.assign(n, INF);
+            route_tmp.assign(n, NONE);
+            used.assign(n, false);
+        } else {
+            for (uint32_t v : touched) {
+                d[v] = INF;
+                route_tmp[v] = NONE;
+                used[v] = false;
+            }
+        }
+        touched.clear();
+        queue.reset(n);
+    }
+
+    /*!
+     * \brief Обновление расстояния до вершины
+     * @param v
+     * @param dist
+     * @param from
+     */
+    void relax(uint32_t v, weight_t dist, uint32_t from) {
+        relax(v, dist, from, dist);
+    }
+
+    /*!
+     * \brief Обновление расстояния до вершины с отдельным приоритетом в очереди (для A*)
+     * @param v
+     * @param dist
+     * @param from
+     * @param priority
+     */
+    void relax(uint32_t v, weight_t dist, uint32_t from, weight_t priority) {
+        if (d[v] == INF) {
+            touched.push_back(v);
+        }
+        d[v] = dist;
+        route_tmp[v] = from;
+        queue.push(v, priority);
+    }
+};
+
+namespace graph_detail {
+    /*!
+     * \brief Проверка перед поиском Дейкстры: веса рёбер снимка неотрицательны
+     * \details Поиск может остановиться до просмотра всех рёбер, поэтому проверки каждого ребра в нём недостаточно.
+     * @param csr
+     */
+    template<typename csr_t>
+    void require_nonnegative_weights(const csr_t& csr) {
+        if (csr.has_negative_weights()) {
+            throw std::logic_error("there are negative weights in the graph.\n");
+        }
+    }
+
+    /*!
+     * \brief Поиск кратчайших путей из вершины from по CSR-снимку
+     * @param csr
+     * @param from
+     * @param to - вершина, после которой поиск останавливается (NONE - обойти всё достижимое)
+     * @param ws
+     */
+    template<typename csr_t, typename weight_t, typename queue_t>
+    void dijkstra_search(const csr_t& csr, uint32_t from, uint32_t to, DijkstraWorkspace<weight_t, queue_t>& ws) {
+        ws.prepare(csr.size());
+        ws.relax(from, 0, ws.NONE);
+
+        while (!ws.queue.empty()) {
+            auto [dist, v] = ws.queue.pop();
+            if (ws.used[v] || ws.d[v] < dist) {
+                continue;
+            }
+            ws.used[v] = true;
+
+            if (v == to) {
+                break;
+            }
+
+            for (size_t e = csr.edges_begin(v); e < csr.edges_end(v); ++e) {
+                weight_t len = csr.weight(e);
+                if (len < 0) {
+                    throw std::logic_error("there are negative weights in the graph.\n");
+                }
+                uint32_t u = csr.target(e);
+                if (ws.d[v] + len < ws.d[u]) {
+                    ws.relax(u, ws.d[v] + len, v);
+                }
+            }
+        }
+    }
+
+    /*!
+     * \brief Восстановление пути по массиву предков в буфер вызывающего
+     * @param csr
+     * @param route_tmp
+     * @param to
+     * @param route
+     */
+    template<typename csr_t, typename route_t>
+    void restore_route(const csr_t& csr, const std::vector<uint32_t>& route_tmp, uint32_t to, route_t& route) {
+        route.clear();
+        for (uint32_t v = to; v != std::numeric_limits<uint32_t>::max(); v = route_tmp[v]) {
+            route.push_back(csr.key(v));
+        }
+        std::reverse(route.begin(), route.end());
+    }
+}
+
+/*!
+ * \brief Алгоритм Дейкстры с переиспользуемыми буферами
+ * \details Работает для любого типа ключа: предки хранятся по плотным номерам вершин, путь пишется в route
+ * (старое содержимое стирается, ёмкость сохраняется). Для CsrGraph запрос не выделяет память,
+ * если буферы уже нужного размера; Graph на каждый запрос строит снимок заново (см. Graph::freeze()).
  * @tparam graph_t
  * @tparam weight_t
  * @tparam route_t
  * @tparam node_name_t
+ * @tparam queue_t
+ * @param graph
+ * @param key_from
+ * @param key_to
+ * @param route - буфер для пути
+ * @param workspace - рабочие буферы
+ * @return Длина кратчайшего пути из вершины с ключом key_from в вершину с ключом key_to.
+ */
+template<typename graph_t, typename weight_t, typename route_t, typename node_name_t, typename queue_t>
+weight_t dijkstra(const graph_t& graph, node_name_t key_from, node_name_t key_to, route_t& route,
+                  DijkstraWorkspace<weight_t, queue_t>& workspace) {
+    graph[key_from];
+    graph[key_to];
+
+    const auto& csr = graph_detail::as_csr(graph);
+    uint32_t from = csr.index(key_from), to = csr.index(key_to);
+
+    graph_detail::require_nonnegative_weights(csr);
+    graph_detail::dijkstra_search(csr, from, to, workspace);
+
+    if (workspace.d[to] == workspace.INF) {
+        throw std::logic_error("nodes are not connected.\n");
+    }
+
+    graph_detail::restore_route(csr, workspace.route_tmp, to, route);
+
+    return workspace.d[to];
+}
+
+/*!
+ * \brief Алгоритм Дейкстры
+ * \details Поиск идёт по CSR-снимку графа (Graph строит снимок заново,
+ * CsrGraph используется как есть), следующая вершина выбирается из очереди с приоритетами: O((V + E) log V).
+ * @tparam graph_t
+ * @tparam weight_t
+ * @tparam route_t
+ * @tparam node_name_t
+ * @tparam queue_t - очередь с приоритетами: BinaryHeap (ленивое удаление) или IndexedDaryHeap (decrease-key)
  * @param graph
  * @param key_from
  * @param key_to
  * @return Возвращает длину кратчайшего пути между из вершины с клучом key_from в вершину с ключом key_to.
  */
-template<typename graph_t, typename weight_t, typename route_t, typename node_name_t>
+template<typename graph_t, typename weight_t, typename route_t, typename node_name_t, typename queue_t = BinaryHeap<weight_t>>
 std::pair<weight_t, route_t> dijkstra(const graph_t& graph, node_name_t key_from, node_name_t key_to) {
+    DijkstraWorkspace<weight_t, queue_t> workspace;
+    route_t route;
+
+    weight_t weight = dijkstra(graph, key_from, key_to, route, workspace);
+
+    return std::pair<weight_t, route_t>(weight, route);
+}
+
+/*!
+ * \brief Двунаправленный алгоритм Дейкстры с переиспользуемыми буферами
+ * \details Прямой поиск идёт из key_from по исходящим рёбрам, обратный - из key_to по входящим рёбрам CSR-снимка.
+ * На каждом шаге продвигается фронт с меньшим минимумом в очереди; поиск останавливается, когда сумма минимумов
+ * обеих очередей не меньше длины лучшего найденного пути.
+ * @tparam graph_t
+ * @tparam weight_t
+ * @tparam route_t
+ * @tparam node_name_t
+ * @tparam queue_t
+ * @param graph
+ * @param key_from
+ * @param key_to
+ * @param route - буфер для пути
+ * @param forward - рабочие буферы прямого поиска
+ * @param backward - рабочие буферы обратного поиска
+ * @return Длина кратчайшего пути из вершины с ключом key_from в вершину с ключом key_to.
+ */
+template<typename graph_t, typename weight_t, typename route_t, typename node_name_t, typename queue_t>
+weight_t bidirectional_dijkstra(const graph_t& graph, node_name_t key_from, node_name_t key_to, route_t& route,
+                                DijkstraWorkspace<weight_t, queue_t>& forward,
+                                DijkstraWorkspace<weight_t, queue_t>& backward) {
     graph[key_from];
     graph[key_to];
 
+    const auto& csr = graph_detail::as_csr(graph);
+    uint32_t from = csr.index(key_from), to = csr.index(key_to);
+    graph_detail::require_nonnegative_weights(csr);
+
+    const weight_t INF = forward.INF;
+    const uint32_t NONE = forward.NONE;
+
+    forward.prepare(csr.size());
+    backward.prepare(csr.size());
+    forward.relax(from, 0, NONE);
+    backward.relax(to, 0, NONE);
+
+    weight_t best = from == to ? 0 : INF; // длина лучшего найденного пути
+    uint32_t meet = from == to ? from : NONE;
+
+    while (!forward.queue.empty() && !backward.queue.empty()) {
+        weight_t forward_min = forward.queue.top().first, backward_min = backward.queue.top().first;
+        if (best != INF && forward_min + backward_min >= best) {
+            break;
+        }
+
+        bool go_forward = forward_min <= backward_min;
+        auto& ws = go_forward ? forward : backward;
+        auto& other = go_forward ? backward : forward;
+
+        auto [dist, v] = ws.queue.pop();
+        if (ws.used[v] || ws.d[v] < dist) {
+            continue;
+        }
+        ws.used[v] = true;
+
+        size_t e_begin = go_forward ? csr.edges_begin(v) : csr.in_edges_begin(v);
+        size_t e_end = go_forward ? csr.edges_end(v) : csr.in_edges_end(v);
+        for (size_t e = e_begin; e < e_end; ++e) {
+            weight_t len = go_forward ? csr.weight(e) : csr.in_weight(e);
+            if (len < 0) {
+                throw std::logic_error("there are negative weights in the graph.\n");
+            }
+            uint32_t u = go_forward ? csr.target(e) : csr.source(e);
+            if (ws.d[v] + len < ws.d[u]) {
+                ws.relax(u, ws.d[v] + len, v);
+            }
+            if (other.d[u] != INF && ws.d[v] + len + other.d[u] < best) {
+                best = ws.d[v] + len + other.d[u];
+                meet = u;
+            }
+        }
+    }
+
+    if (meet == NONE) {
+        throw std::logic_error("nodes are not connected.\n");
+    }
+
+    // от meet к key_from по предкам прямого поиска, затем от meet к key_to по предкам обратного
+    graph_detail::restore_route(csr, forward.route_tmp, meet, route);
+    for (uint32_t v = backward.route_tmp[meet]; v != NONE; v = backward.route_tmp[v]) {
+        route.push_back(csr.key(v));
+    }
 
+    return best;
+}
+
+/*!
+ * \brief Двунаправленный алгоритм Дейкстры для запросов между двумя вершинами
+ * @tparam graph_t
+ * @tparam weight_t
+ * @tparam route_t
+ * @tparam node_name_t
+ * @tparam queue_t
+ * @param graph
+ * @param key_from
+ * @param key_to
+ * @return Возвращает длину кратчайшего пути из вершины с ключом key_from в вершину с ключом key_to и сам путь.
+ */
+template<typename graph_t, typename weight_t, typename route_t, typename node_name_t, typename queue_t = BinaryHeap<weight_t>>
+std::pair<weight_t, route_t> bidirectional_dijkstra(const graph_t& graph, node_name_t key_from, node_name_t key_to) {
+    DijkstraWorkspace<weight_t, queue_t> forward, backward;
     route_t route;
 
-    std::map<node_name_t, node_name_t> route_tmp;
+    weight_t weight = bidirectional_dijkstra(graph, key_from, key_to, route, forward, backward);
 
-    const weight_t INF = std::numeric_limits<weight_t>::max();
+    return std::pair<weight_t, route_t>(weight, route);
+}
 
-    route_tmp[key_from] = std::numeric_limits<node_name_t>::max();
+/*!
+ * \brief Эвристика A*: евклидово расстояние между значениями узлов с полями x, y, z
+ * \details Допустима и согласована, если вес каждого ребра не меньше scale * (расстояние между его концами).
+ */
+struct EuclideanHeuristic {
+    double scale = 1.0;
 
-    std::map<node_name_t, weight_t> d; // d[v]
-    std::map<node_name_t, bool> used;  // used[v] = true/false;
-    for (auto [key, node] : graph) {
-        d[key] = INF;
-        used[key] = false;
+    template<typename point_t>
+    double operator()(const point_t& lhs, const point_t& rhs) const {
+        double dx = lhs.x - rhs.x, dy = lhs.y - rhs.y, dz = lhs.z - rhs.z;
+        return scale * std::sqrt(dx * dx + dy * dy + dz * dz);
     }
-    d[key_from] = 0;
+};
 
-    for (int i = 0; i < graph.size(); i++) {
-        node_name_t v = -1;
+/*!
+ * \brief Алгоритм A* с переиспользуемыми буферами
+ * \details Как dijkstra(), но вершина v извлекается из очереди по d[v] + heuristic(value(v), value(key_to)).
+ * Эвристика должна быть допустимой и согласованной (не переоценивать оставшийся путь),
+ * тогда результат совпадает с dijkstra(), а вершин просматривается меньше.
+ * @tparam graph_t
+ * @tparam weight_t
+ * @tparam route_t
+ * @tparam node_name_t
+ * @tparam heuristic_t - функтор (значение узла, значение целевого узла) -> оценка оставшегося пути
+ * @tparam queue_t
+ * @param graph
+ * @param key_from
+ * @param key_to
+ * @param heuristic
+ * @param route - буфер для пути
+ * @param workspace - рабочие буферы
+ * @return Длина кратчайшего пути из вершины с ключом key_from в вершину с ключом key_to.
+ */
+template<typename graph_t, typename weight_t, typename route_t, typename node_name_t, typename heuristic_t, typename queue_t>
+weight_t astar(const graph_t& graph, node_name_t key_from, node_name_t key_to, const heuristic_t& heuristic,
+               route_t& route, DijkstraWorkspace<weight_t, queue_t>& workspace) {
+    graph[key_from];
+    graph[key_to];
 
-        // d[v] -> min, v: used[v] = false;
+    const auto& csr = graph_detail::as_csr(graph);
+    uint32_t from = csr.index(key_from), to = csr.index(key_to);
+    graph_detail::require_nonnegative_weights(csr);
+    const auto& goal = csr.value(to);
 
-        for (auto [key, node] : graph) {
-            if (!used[key] && (v == -1 || d[key] < d[v])) {
-                v = key;
-            }
+    auto& ws = workspace;
+    ws.prepare(csr.size());
+    ws.relax(from, 0, ws.NONE, static_cast<weight_t>(heuristic(csr.value(from), goal)));
+
+    while (!ws.queue.empty()) {
+        uint32_t v = ws.queue.pop().second;
+        if (ws.used[v]) {
+            continue;
         }
+        ws.used[v] = true;
 
-        if (d[v] == INF) {
+        if (v == to) {
             break;
         }
-        used[v] = true;
 
-        for (auto [to, len] : graph[v]) {
+        for (size_t e = csr.edges_begin(v); e < csr.edges_end(v); ++e) {
+            weight_t len = csr.weight(e);
             if (len < 0) {
                 throw std::logic_error("there are negative weights in the graph.\n");
             }
-            if (d[v] + len < d[to]) {
-                d[to] = d[v] + len;
-                route_tmp[to] = v;
+            uint32_t u = csr.target(e);
+            if (!ws.used[u] && ws.d[v] + len < ws.d[u]) {
+                weight_t dist = ws.d[v] + len;
+                ws.relax(u, dist, v, dist + static_cast<weight_t>(heuristic(csr.value(u), goal)));
+            }
+        }
+    }
+
+    if (ws.d[to] == ws.INF) {
+        throw std::logic_error("nodes are not connected.\n");
+    }
+
+    graph_detail::restore_route(csr, ws.route_tmp, to, route);
+
+    return ws.d[to];
+}
+
+/*!
+ * \brief Алгоритм A*
+ * @tparam graph_t
+ * @tparam weight_t
+ * @tparam route_t
+ * @tparam node_name_t
+ * @tparam heuristic_t
+ * @tparam queue_t
+ * @param graph
+ * @param key_from
+ * @param key_to
+ * @param heuristic
+ * @return Возвращает длину кратчайшего пути из вершины с ключом key_from в вершину с ключом key_to и сам путь.
+ */
+template<typename graph_t, typename weight_t, typename route_t, typename node_name_t,
+         typename heuristic_t = EuclideanHeuristic, typename queue_t = BinaryHeap<weight_t>>
+std::pair<weight_t, route_t> astar(const graph_t& graph, node_name_t key_from, node_name_t key_to,
+                                   const heuristic_t& heuristic = heuristic_t()) {
+    DijkstraWorkspace<weight_t, queue_t> workspace;
+    route_t route;
+
+    weight_t weight = astar(graph, key_from, key_to, heuristic, route, workspace);
+
+    return std::pair<weight_t, route_t>(weight, route);
+}
+
+namespace graph_detail {
+    /*!
+     * \brief Поиск Дейкстры из from, который останавливается, когда просмотрены все отмеченные вершины
+     * @param csr
+     * @param from
+     * @param is_target - is_target[v] = true для искомых вершин
+     * @param targets - число различных искомых вершин
+     * @param ws
+     * @param length - length(v, e) - вес ребра e, выходящего из v (для алгоритма Джонсона - пересчитанный)
+     */
+    template<typename csr_t, typename weight_t, typename queue_t, typename length_t>
+    void dijkstra_to_targets(const csr_t& csr, uint32_t from, const std::vector<char>& is_target, size_t targets,
+                             DijkstraWorkspace<weight_t, queue_t>& ws, const length_t& length) {
+        ws.prepare(csr.size());
+        ws.relax(from, 0, ws.NONE);
+
+        while (!ws.queue.empty() && targets > 0) {
+            auto [dist, v] = ws.queue.pop();
+            if (ws.used[v] || ws.d[v] < dist) {
+                continue;
+            }
+            ws.used[v] = true;
+            if (is_target[v]) {
+                --targets;
+            }
+
+            for (size_t e = csr.edges_begin(v); e < csr.edges_end(v); ++e) {
+                weight_t len = length(v, e);
+                if (len < 0) {
+                    throw std::logic_error("there are negative weights in the graph.\n");
+                }
+                uint32_t u = csr.target(e);
+                if (ws.d[v] + len < ws.d[u]) {
+                    ws.relax(u, ws.d[v] + len, v);
+                }
+            }
+        }
+    }
+
+    /*!
+     * \brief Таблица расстояний из sources в targets поисками dijkstra_to_targets()
+     * \details Ключи переводятся в номера снимка, различные цели отмечаются в is_target. Поиски из источников
+     * распределяются по потокам пула, у каждого потока свои рабочие буферы, переиспользуемые между источниками.
+     * @param csr
+     * @param sources
+     * @param targets
+     * @param pool
+     * @param length - length(v, e) - вес ребра e, выходящего из v
+     * @param cell - cell(from, to, d) - значение ячейки таблицы по расстоянию d, найденному из вершины from в вершину to
+     * @return Матрица sources.size() x targets.size().
+     */
+    template<typename weight_t, typename csr_t, typename node_name_t, typename length_t, typename cell_t>
+    linalg::Matrix<weight_t> distance_table(const csr_t& csr, const std::vector<node_name_t>& sources,
+                                            const std::vector<node_name_t>& targets, ThreadPool& pool,
+                                            const length_t& length, const cell_t& cell) {
+        std::vector<uint32_t> from(sources.size()), to(targets.size());
+        for (size_t i = 0; i < sources.size(); ++i) {
+            from[i] = csr.index(sources[i]);
+        }
+        std::vector<char> is_target(csr.size(), false);
+        size_t distinct = 0;
+        for (size_t j = 0; j < targets.size(); ++j) {
+            to[j] = csr.index(targets[j]);
+            if (!is_target[to[j]]) {
+                is_target[to[j]] = true;
+                ++distinct;
+            }
+        }
+
+        linalg::Matrix<weight_t> table(sources.size(), targets.size());
+        std::vector<DijkstraWorkspace<weight_t>> scratch(pool.size());
+
+        pool.parallel_for(sources.size(), [&](size_t i, size_t worker) {
+            auto& ws = scratch[worker];
+            dijkstra_to_targets(csr, from[i], is_target, distinct, ws, length);
+            for (size_t j = 0; j < to.size(); ++j) {
+                table(i, j) = cell(from[i], to[j], ws.d[to[j]]);
+            }
+        });
+
+        return table;
+    }
+}
+
+/*!
+ * \brief Таблица кратчайших расстояний "многие ко многим"
+ * \details Из каждой вершины sources запускается один поиск Дейкстры, который останавливается, как только найдены
+ * расстояния до всех targets. Поиски распределяются по потокам пула, у каждого потока свои рабочие буферы,
+ * переиспользуемые между источниками. Граф перед поиском один раз переводится в CSR-снимок.
+ * @tparam graph_t
+ * @tparam weight_t
+ * @tparam node_name_t
+ * @param graph
+ * @param sources
+ * @param targets
+ * @param pool - пул потоков (по умолчанию общий)
+ * @return Матрица sources.size() x targets.size(): в ячейке (i, j) длина кратчайшего пути из sources[i]
+ * в targets[j] или std::numeric_limits<weight_t>::max(), если путь не существует.
+ */
+template<typename graph_t, typename weight_t, typename node_name_t>
+linalg::Matrix<weight_t> distance_table(const graph_t& graph, const std::vector<node_name_t>& sources,
+                                        const std::vector<node_name_t>& targets,
+                                        ThreadPool& pool = ThreadPool::shared()) {
+    const auto& csr = graph_detail::as_csr(graph);
+    graph_detail::require_nonnegative_weights(csr);
+
+    return graph_detail::distance_table<weight_t>(csr, sources, targets, pool,
+            [&csr](uint32_t, size_t e) { return csr.weight(e); },
+            [](uint32_t, uint32_t, weight_t dist) { return dist; });
+}
+
+namespace graph_detail {
+    /*!
+     * \brief Алгоритм Беллмана-Форда с очередью (SPFA)
+     * \details Вершина попадает в очередь только после уменьшения расстояния до неё. Длина (в рёбрах) найденного
+     * пути хранится для каждой вершины: если она дошла до числа вершин, путь содержит цикл отрицательного веса.
+     * Начальные вершины - те, у которых d[v] уже конечно (обычно одна вершина, для Джонсона - все с d = 0).
+     * @param csr
+     * @param d - расстояния (размер csr.size())
+     * @param parent - предыдущая вершина на пути или NONE (размер csr.size())
+     * @return bool - true, если отрицательных циклов, достижимых из начальных вершин, нет, false - иначе.
+     */
+    template<typename csr_t, typename weight_t>
+    bool spfa(const csr_t& csr, std::vector<weight_t>& d, std::vector<uint32_t>& parent) {
+        const weight_t INF = std::numeric_limits<weight_t>::max();
+        size_t n = csr.size();
+
+        std::vector<uint32_t> queue;          // кольцевой буфер: в очереди не больше n вершин
+        queue.reserve(n);
+        std::vector<char> queued(n, false);
+        std::vector<uint32_t> hops(n, 0);
+        for (uint32_t v = 0; v < n; ++v) {
+            if (d[v] != INF) {
+                queue.push_back(v);
+                queued[v] = true;
             }
         }
+        size_t head = 0, count = queue.size();
+        queue.resize(n);
+
+        while (count > 0) {
+            uint32_t v = queue[head];
+            head = head + 1 == n ? 0 : head + 1;
+            --count;
+            queued[v] = false;
+
+            for (size_t e = csr.edges_begin(v); e < csr.edges_end(v); ++e) {
+                uint32_t u = csr.target(e);
+                if (d[v] + csr.weight(e) < d[u]) {
+                    d[u] = d[v] + csr.weight(e);
+                    parent[u] = v;
+                    hops[u] = hops[v] + 1;
+                    if (hops[u] >= n) {
+                        return false;
+                    }
+                    if (!queued[u]) {
+                        size_t tail = head + count < n ? head + count : head + count - n;
+                        queue[tail] = u;
+                        queued[u] = true;
+                        ++count;
+                    }
+                }
+            }
+        }
+        return true;
     }
+}
 
-    if (route_tmp.find(key_to) == route_tmp.end()) {
+/*!
+ * \brief Алгоритм Беллмана-Форда (SPFA) для графов с отрицательными весами
+ * \details Работает по CSR-снимку графа. В среднем O(E) на разреженных графах, в худшем случае O(V * E).
+ * @tparam graph_t
+ * @tparam weight_t
+ * @tparam route_t
+ * @tparam node_name_t
+ * @param graph
+ * @param key_from
+ * @param key_to
+ * @return Возвращает длину кратчайшего пути из вершины с ключом key_from в вершину с ключом key_to и сам путь.
+ */
+template<typename graph_t, typename weight_t, typename route_t, typename node_name_t>
+std::pair<weight_t, route_t> bellman_ford(const graph_t& graph, node_name_t key_from, node_name_t key_to) {
+    graph[key_from];
+    graph[key_to];
+
+    const auto& csr = graph_detail::as_csr(graph);
+    uint32_t from = csr.index(key_from), to = csr.index(key_to);
+
+    std::vector<weight_t> d(csr.size(), std::numeric_limits<weight_t>::max());
+    std::vector<uint32_t> parent(csr.size(), std::numeric_limits<uint32_t>::max());
+    d[from] = 0;
+
+    if (!graph_detail::spfa(csr, d, parent)) {
+        throw std::logic_error("there is a negative cycle in the graph.\n");
+    }
+    if (d[to] == std::numeric_limits<weight_t>::max()) {
         throw std::logic_error("nodes are not connected.\n");
     }
 
-    for (auto key = key_to; route_tmp[key] < std::numeric_limits<node_name_t>::max(); ) {
-        route.push_back(key);
-        key = route_tmp[key];
+    route_t route;
+    graph_detail::restore_route(csr, parent, to, route);
+
+    return std::pair<weight_t, route_t>(d[to], route);
+}
+
+/*!
+ * \brief Таблица кратчайших расстояний для графов с отрицательными весами (алгоритм Джонсона)
+ * \details Один проход SPFA из фиктивной вершины, соединённой со всеми вершинами рёбрами веса 0, даёт потенциалы h,
+ * после чего веса w(u, v) + h(u) - h(v) неотрицательны и из каждого источника параллельно запускается Дейкстра,
+ * как в distance_table(). Для всех пар вершин достаточно передать все ключи в sources и targets.
+ * @tparam graph_t
+ * @tparam weight_t
+ * @tparam node_name_t
+ * @param graph
+ * @param sources
+ * @param targets
+ * @param pool - пул потоков (по умолчанию общий)
+ * @return Матрица sources.size() x targets.size(): в ячейке (i, j) длина кратчайшего пути из sources[i]
+ * в targets[j] или std::numeric_limits<weight_t>::max(), если путь не существует.
+ */
+template<typename graph_t, typename weight_t, typename node_name_t>
+linalg::Matrix<weight_t> johnson(const graph_t& graph, const std::vector<node_name_t>& sources,
+                                 const std::vector<node_name_t>& targets,
+                                 ThreadPool& pool = ThreadPool::shared()) {
+    const auto& csr = graph_detail::as_csr(graph);
+    const weight_t INF = std::numeric_limits<weight_t>::max();
+
+    std::vector<weight_t> h(csr.size(), 0);
+    std::vector<uint32_t> parent(csr.size(), std::numeric_limits<uint32_t>::max());
+    if (!graph_detail::spfa(csr, h, parent)) {
+        throw std::logic_error("there is a negative cycle in the graph.\n");
     }
 
-    route.push_back(key_from);
-    std::reverse(route.begin(), route.end());
+    // ошибки округления не должны делать пересчитанный вес отрицательным
+    auto length = [&csr, &h](uint32_t v, size_t e) {
+        weight_t len = csr.weight(e) + h[v] - h[csr.target(e)];
+        return len < 0 ? weight_t(0) : len;
+    };
 
-    return std::pair<weight_t, route_t>(d[key_to], route);
+    return graph_detail::distance_table<weight_t>(csr, sources, targets, pool, length,
+            [&](uint32_t from, uint32_t to, weight_t dist) { return dist == INF ? INF : dist - h[from] + h[to]; });
+}
+
+namespace graph_detail {
+    /*!
+     * \brief Итерации PageRank по CSR-снимку (схема "pull")
+     * \details Новый ранг вершины v собирается по её входящим рёбрам из вклада contrib[u] = rank[u] / deg_out(u)
+     * источников, поэтому каждая вершина пишет только свои элементы и вершины делятся между потоками без
+     * синхронизации. Входящие рёбра лежат в снимке подряд, вклад источников - в плотном массиве. Ранг висячих вершин
+     * (без исходящих рёбер) распределяется поровну между всеми вершинами. Вклад и сумма висячих рангов для следующей
+     * итерации считаются в том же проходе, что и новые ранги; итерации останавливаются, когда сумма |изменений|
+     * рангов становится меньше tol.
+     * @param csr
+     * @param damping - вероятность перехода по ребру
+     * @param tol
+     * @param max_iterations
+     * @param rank - ранги по номерам вершин снимка (сумма равна 1)
+     * @param pool
+     * @return Число выполненных итераций.
+     */
+    template<typename csr_t>
+    size_t pagerank(const csr_t& csr, double damping, double tol, size_t max_iterations, std::vector<double>& rank,
+                    ThreadPool& pool) {
+        const size_t n = csr.size();
+        rank.assign(n, n ? 1.0 / n : 0.0);
+        if (n == 0) {
+            return 0;
+        }
+
+        std::vector<double> inv_degree(n), contrib(n), next_contrib(n);
+        double dangling = 0;
+        for (uint32_t v = 0; v < n; ++v) {
+            size_t degree = csr.edges_end(v) - csr.edges_begin(v);
+            inv_degree[v] = degree ? 1.0 / degree : 0.0;
+            contrib[v] = rank[v] * inv_degree[v];
+            dangling += degree ? 0.0 : rank[v];
+        }
+
+        // куски по ~64K входящих рёбер, частичные суммы - по кускам (порядок сложения не зависит от числа потоков)
+        const size_t grain = std::max<size_t>(256, (size_t(1) << 16) / (csr.edge_count() / n + 1));
+        const size_t chunks = (n + grain - 1) / grain;
+        std::vector<double> chunk_change(chunks), chunk_dangling(chunks);
+
+        size_t iteration = 0;
+        while (iteration < max_iterations) {
+            ++iteration;
+            const double base = (1.0 - damping) / n + damping * dangling / n;
+            pool.parallel_for(chunks, [&](size_t chunk, size_t) {
+                double change = 0, hanging = 0;
+                for (size_t v = chunk * grain; v < std::min(n, (chunk + 1) * grain); ++v) {
+                    double sum = 0;
+                    for (size_t e = csr.in_edges_begin(uint32_t(v)); e < csr.in_edges_end(uint32_t(v)); ++e) {
+                        sum += contrib[csr.source(e)];
+                    }
+                    double value = base + damping * sum;
+                    change += std::abs(value - rank[v]);
+                    rank[v] = value;
+                    next_contrib[v] = value * inv_degree[v];
+                    hanging += inv_degree[v] == 0.0 ? value : 0.0;
+                }
+                chunk_change[chunk] = change;
+                chunk_dangling[chunk] = hanging;
+            });
+            contrib.swap(next_contrib);
+
+            double change = 0;
+            dangling = 0;
+            for (size_t chunk = 0; chunk < chunks; ++chunk) {
+                change += chunk_change[chunk];
+                dangling += chunk_dangling[chunk];
+            }
+            if (change < tol) {
+                break;
+            }
+        }
+        return iteration;
+    }
+}
+
+/*!
+ * \brief PageRank вершин графа
+ * \details Граф один раз переводится в CSR-снимок, входящие рёбра которого служат раскладкой для схемы "pull";
+ * итерации идут параллельно на пуле потоков (см. graph_detail::pagerank). Веса рёбер не учитываются.
+ * @tparam graph_t - Graph или CsrGraph
+ * @param graph
+ * @param damping - вероятность перехода по ребру (обычно 0.85)
+ * @param tol - точность: сумма |изменений| рангов за итерацию
+ * @param max_iterations
+ * @param pool - пул потоков (по умолчанию общий)
+ * @return Ранги по ключам вершин (сумма равна 1).
+ */
+template<typename graph_t>
+auto pagerank(const graph_t& graph, double damping = 0.85, double tol = 1e-6, size_t max_iterations = 100,
+              ThreadPool& pool = ThreadPool::shared()) {
+    if (damping < 0 || damping >= 1) {
+        throw std::logic_error("damping factor must be in [0, 1).\n");
+    }
+    const auto& csr = graph_detail::as_csr(graph);
+    typedef typename std::decay<decltype(csr.key(0))>::type key_type;
+
+    std::vector<double> rank;
+    graph_detail::pagerank(csr, damping, tol, max_iterations, rank, pool);
+
+    std::map<key_type, double> scores;
+    for (uint32_t v = 0; v < csr.size(); ++v) {
+        scores.emplace_hint(scores.end(), csr.key(v), rank[v]);
+    }
+    return scores;
+}
+
+/*!
+ * \brief Дерево обхода в ширину: число рёбер до каждой вершины и предок на кратчайшем (по числу рёбер) пути
+ * \details Массивы индексируются номерами вершин CSR-снимка (ключи по возрастанию), соответствие номеров ключам
+ * хранится в keys.
+ * @tparam key_type
+ */
+template<typename key_type>
+struct BfsTree {
+    /*!
+     * \brief Значение hops и parent для недостижимых вершин (и parent для начальной)
+     */
+    static constexpr uint32_t NONE = std::numeric_limits<uint32_t>::max();
+
+    std::vector<key_type> keys;    // keys[v] - ключ вершины v
+    std::vector<uint32_t> hops;    // hops[v] - число рёбер от начальной вершины до v или NONE
+    std::vector<uint32_t> parent;  // parent[v] - предыдущая вершина на пути или NONE
+
+    /*!
+     * \brief Номер вершины по ключу
+     * @param key
+     * @return Номер вершины.
+     */
+    uint32_t index(const key_type& key) const {
+        return graph_detail::key_index(keys, key);
+    }
+
+    /*!
+     * \brief Проверка достижимости вершины
+     * @param key
+     * @return bool - true, если вершина достижима из начальной, false - иначе.
+     */
+    bool reached(const key_type& key) const {
+        return hops[index(key)] != NONE;
+    }
+
+    /*!
+     * \brief Путь от начальной вершины до вершины с ключом key
+     * @param key
+     * @return Ключи вершин пути, начиная с начальной.
+     */
+    std::vector<key_type> route(const key_type& key) const {
+        uint32_t v = index(key);
+        if (hops[v] == NONE) {
+            throw std::logic_error("nodes are not connected.\n");
+        }
+        std::vector<key_type> result;
+        for (; v != NONE; v = parent[v]) {
+            result.push_back(keys[v]);
+        }
+        std::reverse(result.begin(), result.end());
+        return result;
+    }
+};
+
+namespace graph_detail {
+    /*!
+     * \brief Обход в ширину с выбором направления (Beamer, Asanović, Patterson)
+     * \details Каждый уровень обходится одним из двух способов:
+     * - сверху вниз: вершины фронта просматривают исходящие рёбра и захватывают непосещённых соседей
+     *   (атомарная установка бита в битовой карте посещённых);
+     * - снизу вверх: каждая непосещённая вершина просматривает свои входящие рёбра, пока не найдёт вершину фронта
+     *   (фронт - битовая карта); вершине не нужны атомарные операции, и просмотр обрывается на первом родителе.
+     * Снизу вверх выгоднее, когда фронт большой: переход происходит, когда рёбер фронта больше 1/alpha рёбер
+     * непосещённых вершин, обратный - когда во фронте меньше n/beta вершин. Уровень делится между потоками пула
+     * кусками, кратными 64 вершинам, так что в режиме снизу вверх каждое слово битовой карты пишет один поток.
+     * @param csr
+     * @param from
+     * @param to - вершина, после уровня которой обход останавливается (NONE - обойти всё достижимое)
+     * @param hops - число рёбер от from (NONE - не достигнута)
+     * @param parent - предок на пути (NONE - нет)
+     * @param pool
+     * @param direction_optimizing - false: всегда сверху вниз (для сравнения)
+     */
+    template<typename csr_t>
+    void bfs(const csr_t& csr, uint32_t from, uint32_t to, std::vector<uint32_t>& hops, std::vector<uint32_t>& parent,
+             ThreadPool& pool, bool direction_optimizing = true) {
+        const uint32_t NONE = std::numeric_limits<uint32_t>::max();
+        const size_t alpha = 14, beta = 24;
+        const size_t n = csr.size(), words = (n + 63) / 64;
+        hops.assign(n, NONE);
+        parent.assign(n, NONE);
+
+        std::vector<std::atomic<uint64_t>> visited(words);
+        std::vector<uint64_t> frontier_bits(words), next_bits(words);
+        auto out_degree = [&csr](uint32_t v) { return csr.edges_end(v) - csr.edges_begin(v); };
+
+        std::vector<uint32_t> frontier{from};
+        std::vector<std::vector<uint32_t>> local(pool.size());
+        std::vector<size_t> local_edges(pool.size()), local_count(pool.size());
+        hops[from] = 0;
+        visited[from / 64].fetch_or(uint64_t(1) << (from % 64), std::memory_order_relaxed);
+
+        size_t frontier_size = 1, frontier_edges = out_degree(from), unexplored_edges = csr.edge_count() - frontier_edges;
+        bool bottom_up = false;
+        for (uint32_t level = 1; frontier_size > 0 && (to == NONE || hops[to] == NONE); ++level) {
+            if (direction_optimizing) {
+                bool switch_down = !bottom_up && frontier_edges > unexplored_edges / alpha;
+                bool switch_up = bottom_up && frontier_size < n / beta;
+                if (switch_down) {
+                    std::fill(frontier_bits.begin(), frontier_bits.end(), 0);
+                    for (uint32_t v : frontier) {
+                        frontier_bits[v / 64] |= uint64_t(1) << (v % 64);
+                    }
+                    bottom_up = true;
+                } else if (switch_up) {
+                    frontier.clear();
+                    for (size_t w = 0; w < words; ++w) {
+                        for (size_t b = 0; b < 64; ++b) {
+                            if (frontier_bits[w] >> b & 1) {
+                                frontier.push_back(uint32_t(w * 64 + b));
+                            }
+                        }
+                    }
+                    bottom_up = false;
+                }
+            }
+            std::fill(local_edges.begin(), local_edges.end(), 0);
+            std::fill(local_count.begin(), local_count.end(), 0);
+
+            if (bottom_up) {
+                const size_t grain = 64 * 64;
+                pool.parallel_for((n + grain - 1) / grain, [&](size_t chunk, size_t worker) {
+                    size_t end = std::min(n, (chunk + 1) * grain);
+                    for (size_t w = chunk * grain / 64; w * 64 < end; ++w) {
+                        uint64_t seen = visited[w].load(std::memory_order_relaxed), found = 0;
+                        for (size_t v = w * 64; v < std::min(end, w * 64 + 64); ++v) {
+                            if (seen >> (v % 64) & 1) {
+                                continue;
+                            }
+                            for (size_t e = csr.in_edges_begin(uint32_t(v)); e < csr.in_edges_end(uint32_t(v)); ++e) {
+                                uint32_t u = csr.source(e);
+                                if (frontier_bits[u / 64] >> (u % 64) & 1) {
+                                    hops[v] = level;
+                                    parent[v] = u;
+                                    found |= uint64_t(1) << (v % 64);
+                                    local_edges[worker] += out_degree(uint32_t(v));
+                                    ++local_count[worker];
+                                    break;
+                                }
+                            }
+                        }
+                        next_bits[w] = found;
+                        visited[w].store(seen | found, std::memory_order_relaxed);
+                    }
+                });
+                frontier_bits.swap(next_bits);
+            } else {
+                const size_t grain = 256;
+                pool.parallel_for((frontier.size() + grain - 1) / grain, [&](size_t chunk, size_t worker) {
+                    for (size_t k = chunk * grain; k < std::min(frontier.size(), (chunk + 1) * grain); ++k) {
+                        uint32_t u = frontier[k];
+                        for (size_t e = csr.edges_begin(u); e < csr.edges_end(u); ++e) {
+                            uint32_t v = csr.target(e);
+                            uint64_t bit = uint64_t(1) << (v % 64);
+                            if ((visited[v / 64].load(std::memory_order_relaxed) & bit)
+                                || (visited[v / 64].fetch_or(bit, std::memory_order_relaxed) & bit)) {
+                                continue;
+                            }
+                            hops[v] = level;
+                            parent[v] = u;
+                            local[worker].push_back(v);
+                            local_edges[worker] += out_degree(v);
+                        }
+                    }
+                });
+                frontier.clear();
+                for (std::vector<uint32_t>& part : local) {
+                    frontier.insert(frontier.end(), part.begin(), part.end());
+                    local_count[0] += part.size();
+                    part.clear();
+                }
+            }
+
+            frontier_size = 0;
+            frontier_edges = 0;
+            for (size_t worker = 0; worker < pool.size(); ++worker) {
+                frontier_size += local_count[worker];
+                frontier_edges += local_edges[worker];
+            }
+            unexplored_edges -= frontier_edges;
+        }
+    }
+}
+
+/*!
+ * \brief Обход в ширину из вершины key_from: число рёбер до всех вершин и дерево кратчайших путей
+ * \details Граф один раз переводится в CSR-снимок; обход многопоточный, с выбором направления (см. graph_detail::bfs).
+ * Веса рёбер не учитываются.
+ * @tparam graph_t - Graph или CsrGraph
+ * @tparam node_name_t
+ * @param graph
+ * @param key_from
+ * @param pool - пул потоков (по умолчанию общий)
+ * @return Число рёбер и предки для всех вершин.
+ */
+template<typename graph_t, typename node_name_t>
+auto bfs(const graph_t& graph, const node_name_t& key_from, ThreadPool& pool = ThreadPool::shared()) {
+    const auto& csr = graph_detail::as_csr(graph);
+    typedef typename std::decay<decltype(csr.key(0))>::type key_type;
+
+    BfsTree<key_type> tree;
+    graph_detail::bfs(csr, csr.index(key_from), BfsTree<key_type>::NONE, tree.hops, tree.parent, pool);
+    tree.keys = graph_detail::snapshot_keys(csr);
+    return tree;
+}
+
+/*!
+ * \brief Наименьшее число рёбер на пути из key_from в key_to
+ * \details Обход в ширину останавливается на уровне, где найдена key_to.
+ * @tparam graph_t - Graph или CsrGraph
+ * @tparam node_name_t
+ * @param graph
+ * @param key_from
+ * @param key_to
+ * @param pool - пул потоков (по умолчанию общий)
+ * @return Число рёбер.
+ */
+template<typename graph_t, typename node_name_t>
+size_t hop_distance(const graph_t& graph, const node_name_t& key_from, const node_name_t& key_to,
+                    ThreadPool& pool = ThreadPool::shared()) {
+    const auto& csr = graph_detail::as_csr(graph);
+    uint32_t from = csr.index(key_from), to = csr.index(key_to);
+
+    std::vector<uint32_t> hops, parent;
+    graph_detail::bfs(csr, from, to, hops, parent, pool);
+    if (hops[to] == std::numeric_limits<uint32_t>::max()) {
+        throw std::logic_error("nodes are not connected.\n");
+    }
+    return hops[to];
+}
+
+/*!
+ * \brief Проверка достижимости вершины key_to из key_from
+ * @tparam graph_t - Graph или CsrGraph
+ * @tparam node_name_t
+ * @param graph
+ * @param key_from
+ * @param key_to
+ * @param pool - пул потоков (по умолчанию общий)
+ * @return bool - true, если путь существует, false - иначе.
+ */
+template<typename graph_t, typename node_name_t>
+bool reachable(const graph_t& graph, const node_name_t& key_from, const node_name_t& key_to,
+               ThreadPool& pool = ThreadPool::shared()) {
+    const auto& csr = graph_detail::as_csr(graph);
+    uint32_t from = csr.index(key_from), to = csr.index(key_to);
+
+    std::vector<uint32_t> hops, parent;
+    graph_detail::bfs(csr, from, to, hops, parent, pool);
+    return hops[to] != std::numeric_limits<uint32_t>::max();
+}
+
+namespace graph_detail {
+    /*!
+     * \brief Система непересекающихся множеств без блокировок
+     * \details Корень множества - его элемент с наименьшим номером: объединение подвешивает корень с большим номером
+     * к корню с меньшим одной операцией compare_exchange, поэтому циклов не бывает и unite() можно вызывать из многих
+     * потоков одновременно. find() сокращает пути вдвое (каждый элемент перевешивается на деда), тоже через
+     * compare_exchange; неудача означает лишь, что другой поток уже укоротил путь.
+     */
+    class ConcurrentUnionFind {
+        std::vector<std::atomic<uint32_t>> parent;
+
+    public:
+        explicit ConcurrentUnionFind(size_t n) : parent(n) {
+            for (size_t v = 0; v < n; ++v) {
+                parent[v].store(static_cast<uint32_t>(v), std::memory_order_relaxed);
+            }
+        }
+
+        size_t size() const noexcept {
+            return parent.size();
+        }
+
+        /*!
+         * \brief Корень множества, содержащего v
+         */
+        uint32_t find(uint32_t v) {
+            for (;;) {
+                uint32_t p = parent[v].load(std::memory_order_acquire);
+                if (p == v) {
+                    return v;
+                }
+                uint32_t grandparent = parent[p].load(std::memory_order_acquire);
+                if (p != grandparent) {
+                    parent[v].compare_exchange_weak(p, grandparent, std::memory_order_acq_rel);
+                }
+                v = grandparent;
+            }
+        }
+
+        /*!
+         * \brief Объединение множеств, содержащих a и b
+         * @return bool - true, если множества были разными, false - иначе.
+         */
+        bool unite(uint32_t a, uint32_t b) {
+            for (;;) {
+                a = find(a);
+                b = find(b);
+                if (a == b) {
+                    return false;
+                }
+                if (a < b) {
+                    std::swap(a, b);
+                }
+                // a мог перестать быть корнем, пока искали b: тогда повтор
+                uint32_t expected = a;
+                if (parent[a].compare_exchange_strong(expected, b, std::memory_order_acq_rel)) {
+                    return true;
+                }
+            }
+        }
+
+        bool same(uint32_t a, uint32_t b) {
+            for (;;) {
+                a = find(a);
+                b = find(b);
+                if (a == b) {
+                    return true;
+                }
+                // a - всё ещё корень: значит, в момент проверки множества действительно были разными
+                if (parent[a].load(std::memory_order_acquire) == a) {
+                    return false;
+                }
+            }
+        }
+    };
+}
+
+/*!
+ * \brief Разбиение вершин графа на компоненты
+ * \details Номера компонент плотные, от 0 до count - 1; массивы индексируются номерами вершин CSR-снимка
+ * (ключи по возрастанию).
+ * @tparam key_type
+ */
+template<typename key_type>
+struct Components {
+    std::vector<key_type> keys;       // keys[v] - ключ вершины v
+    std::vector<uint32_t> component;  // component[v] - номер компоненты вершины v
+    size_t count = 0;                 // число компонент
+
+    /*!
+     * \brief Номер вершины по ключу
+     * @param key
+     * @return Номер вершины.
+     */
+    uint32_t index(const key_type& key) const {
+        return graph_detail::key_index(keys, key);
+    }
+
+    /*!
+     * \brief Номер компоненты вершины
+     * @param key
+     * @return Номер компоненты.
+     */
+    uint32_t operator[](const key_type& key) const {
+        return component[index(key)];
+    }
+
+    /*!
+     * \brief Размеры компонент
+     * @return sizes[c] - число вершин в компоненте c.
+     */
+    std::vector<size_t> sizes() const {
+        std::vector<size_t> result(count, 0);
+        for (uint32_t c : component) {
+            ++result[c];
+        }
+        return result;
+    }
+};
+
+namespace graph_detail {
+    /*!
+     * \brief Компоненты слабой связности снимка
+     * \details Вершины делятся между потоками пула, каждый объединяет концы исходящих рёбер своих вершин в общей
+     * ConcurrentUnionFind. Номера компонент - в порядке наименьших вершин компонент (от числа потоков не зависят).
+     * @param csr
+     * @param component - номер компоненты по номеру вершины
+     * @param pool
+     * @return Число компонент.
+     */
+    template<typename csr_t>
+    size_t weak_components(const csr_t& csr, std::vector<uint32_t>& component, ThreadPool& pool) {
+        const size_t n = csr.size();
+        ConcurrentUnionFind sets(n);
+
+        const size_t grain = std::max<size_t>(256, (size_t(1) << 14) / (csr.edge_count() / std::max<size_t>(n, 1) + 1));
+        pool.parallel_for((n + grain - 1) / grain, [&](size_t chunk, size_t) {
+            for (size_t v = chunk * grain; v < std::min(n, (chunk + 1) * grain); ++v) {
+                for (size_t e = csr.edges_begin(uint32_t(v)); e < csr.edges_end(uint32_t(v)); ++e) {
+                    sets.unite(uint32_t(v), csr.target(e));
+                }
+            }
+        });
+
+        // корень - наименьшая вершина множества, поэтому он получает номер раньше остальных вершин
+        component.resize(n);
+        size_t count = 0;
+        for (uint32_t v = 0; v < n; ++v) {
+            uint32_t root = sets.find(v);
+            component[v] = root == v ? static_cast<uint32_t>(count++) : component[root];
+        }
+        return count;
+    }
+
+    /*!
+     * \brief Компоненты сильной связности снимка (алгоритм Тарьяна без рекурсии)
+     * \details Рекурсия заменена явным стеком пар (вершина, следующее ребро), так что глубина обхода ограничена только
+     * памятью. Вершина лежит в стеке Тарьяна, пока она посещена, а номер компоненты ей ещё не выдан. Компоненты
+     * нумеруются в порядке завершения, т.е. в обратном топологическом порядке графа компонент: ребро между разными
+     * компонентами всегда ведёт из компоненты с большим номером в компоненту с меньшим.
+     * @param csr
+     * @param component - номер компоненты по номеру вершины
+     * @return Число компонент.
+     */
+    template<typename csr_t>
+    size_t strong_components(const csr_t& csr, std::vector<uint32_t>& component) {
+        const uint32_t NONE = std::numeric_limits<uint32_t>::max();
+        const size_t n = csr.size();
+        std::vector<uint32_t> order(n, NONE), low(n);
+        std::vector<uint32_t> stack;
+        std::vector<std::pair<uint32_t, size_t>> calls;  // (вершина, следующее ребро)
+        component.assign(n, NONE);
+
+        uint32_t counter = 0;
+        size_t count = 0;
+        auto visit = [&](uint32_t v) {
+            order[v] = low[v] = counter++;
+            stack.push_back(v);
+            calls.emplace_back(v, csr.edges_begin(v));
+        };
+
+        for (uint32_t start = 0; start < n; ++start) {
+            if (order[start] != NONE) {
+                continue;
+            }
+            visit(start);
+            while (!calls.empty()) {
+                uint32_t v = calls.back().first;
+                size_t& e = calls.back().second;
+                if (e < csr.edges_end(v)) {
+                    uint32_t w = csr.target(e++);
+                    if (order[w] == NONE) {
+                        visit(w);
+                    } else if (component[w] == NONE) {
+                        low[v] = std::min(low[v], order[w]);
+                    }
+                    continue;
+                }
+
+                calls.pop_back();
+                if (low[v] == order[v]) {
+                    uint32_t w;
+                    do {
+                        w = stack.back();
+                        stack.pop_back();
+                        component[w] = static_cast<uint32_t>(count);
+                    } while (w != v);
+                    ++count;
+                }
+                if (!calls.empty()) {
+                    uint32_t parent = calls.back().first;
+                    low[parent] = std::min(low[parent], low[v]);
+                }
+            }
+        }
+        return count;
+    }
+}
+
+/*!
+ * \brief Компоненты слабой связности (направление рёбер не учитывается)
+ * \details Параллельно на пуле потоков, через систему непересекающихся множеств без блокировок.
+ * @tparam graph_t - Graph или CsrGraph
+ * @param graph
+ * @param pool - пул потоков (по умолчанию общий)
+ * @return Плотные номера компонент по вершинам.
+ */
+template<typename graph_t>
+auto weak_components(const graph_t& graph, ThreadPool& pool = ThreadPool::shared()) {
+    const auto& csr = graph_detail::as_csr(graph);
+    Components<typename std::decay<decltype(csr.key(0))>::type> result;
+    result.count = graph_detail::weak_components(csr, result.component, pool);
+    result.keys = graph_detail::snapshot_keys(csr);
+    return result;
+}
+
+/*!
+ * \brief Компоненты сильной связности
+ * \details Итеративный алгоритм Тарьяна, O(n + m) и без рекурсии; номера компонент - в обратном топологическом
+ * порядке (см. graph_detail::strong_components).
+ * @tparam graph_t - Graph или CsrGraph
+ * @param graph
+ * @return Плотные номера компонент по вершинам.
+ */
+template<typename graph_t>
+auto strong_components(const graph_t& graph) {
+    const auto& csr = graph_detail::as_csr(graph);
+    Components<typename std::decay<decltype(csr.key(0))>::type> result;
+    result.count = graph_detail::strong_components(csr, result.component);
+    result.keys = graph_detail::snapshot_keys(csr);
+    return result;
+}
+
+/*!
+ * \brief Остовный лес минимального веса
+ * \details Рёбра считаются неориентированными: ребро u -> v и ребро v -> u - два варианта одного ребра {u, v}, петли
+ * не рассматриваются. В каждом ребре леса from < to.
+ * @tparam key_type
+ * @tparam weight_type
+ */
+template<typename key_type, typename weight_type>
+struct SpanningForest {
+    struct Edge {
+        key_type from;
+        key_type to;
+        weight_type weight;
+    };
+
+    std::vector<Edge> edges;  // рёбра леса
+    weight_type total = 0;    // суммарный вес
+    size_t trees = 0;         // число деревьев (компонент связности, считая одиночные вершины)
+};
+
+namespace graph_detail {
+    /*!
+     * \brief Неориентированное ребро снимка: u < v
+     */
+    template<typename weight_t>
+    struct UndirectedEdge {
+        uint32_t u;
+        uint32_t v;
+        weight_t weight;
+
+        /*!
+         * \brief Строгий порядок по (вес, u, v): при нём минимальный остовный лес единственен
+         */
+        bool operator<(const UndirectedEdge& rhs) const {
+            if (weight < rhs.weight || rhs.weight < weight) {
+                return weight < rhs.weight;
+            }
+            return u != rhs.u ? u < rhs.u : v < rhs.v;
+        }
+    };
+
+    /*!
+     * \brief Все рёбра снимка как неориентированные (без петель)
+     */
+    template<typename csr_t>
+    auto undirected_edges(const csr_t& csr) {
+        typedef typename std::decay<decltype(csr.weight(0))>::type weight_t;
+        std::vector<UndirectedEdge<weight_t>> edges;
+        edges.reserve(csr.edge_count());
+        for (uint32_t u = 0; u < csr.size(); ++u) {
+            for (size_t e = csr.edges_begin(u); e < csr.edges_end(u); ++e) {
+                uint32_t v = csr.target(e);
+                if (u != v) {
+                    edges.push_back({std::min(u, v), std::max(u, v), csr.weight(e)});
+                }
+            }
+        }
+        return edges;
+    }
+
+    /*!
+     * \brief Параллельная сортировка слиянием
+     * \details Массив делится на pool.size() частей, которые сортируются std::sort в своих потоках, затем части
+     * попарно сливаются через буфер; слияния одного раунда тоже идут параллельно.
+     */
+    template<typename item_t, typename less_t>
+    void parallel_sort(std::vector<item_t>& items, less_t less, ThreadPool& pool) {
+        const size_t parts = pool.size();
+        if (parts == 1 || items.size() < (size_t(1) << 15)) {
+            std::sort(items.begin(), items.end(), less);
+            return;
+        }
+
+        std::vector<size_t> bounds(parts + 1);
+        for (size_t p = 0; p <= parts; ++p) {
+            bounds[p] = items.size() * p / parts;
+        }
+        pool.parallel_for(parts, [&](size_t p, size_t) {
+            std::sort(items.begin() + bounds[p], items.begin() + bounds[p + 1], less);
+        });
+
+        std::vector<item_t> buffer(items.size());
+        for (size_t width = 1; width < parts; width *= 2) {
+            pool.parallel_for((parts + 2 * width - 1) / (2 * width), [&](size_t pair, size_t) {
+                size_t lo = bounds[pair * 2 * width];
+                size_t mid = bounds[std::min(parts, pair * 2 * width + width)];
+                size_t hi = bounds[std::min(parts, (pair + 1) * 2 * width)];
+                std::merge(items.begin() + lo, items.begin() + mid, items.begin() + mid, items.begin() + hi,
+                           buffer.begin() + lo, less);
+            });
+            items.swap(buffer);
+        }
+    }
+
+    /*!
+     * \brief Лес из выбранных рёбер: ключи вместо номеров, суммарный вес и число деревьев
+     */
+    template<typename csr_t, typename edge_t>
+    auto spanning_forest(const csr_t& csr, const std::vector<edge_t>& chosen) {
+        typedef typename std::decay<decltype(csr.key(0))>::type key_type;
+        typedef typename std::decay<decltype(csr.weight(0))>::type weight_t;
+
+        SpanningForest<key_type, weight_t> forest;
+        forest.edges.reserve(chosen.size());
+        for (const edge_t& edge : chosen) {
+            forest.edges.push_back({csr.key(edge.u), csr.key(edge.v), edge.weight});
+            forest.total += edge.weight;
+        }
+        forest.trees = csr.size() - chosen.size();
+        return forest;
+    }
+}
+
+/*!
+ * \brief Минимальный остовный лес алгоритмом Краскала
+ * \details Рёбра сортируются параллельно (graph_detail::parallel_sort), затем просматриваются по возрастанию веса,
+ * и ребро берётся, если соединяет разные множества системы непересекающихся множеств. Просмотр заканчивается,
+ * как только взято n - 1 ребро.
+ * @tparam graph_t - Graph или CsrGraph
+ * @param graph
+ * @param pool - пул потоков для сортировки (по умолчанию общий)
+ * @return Рёбра леса, суммарный вес и число деревьев.
+ */
+template<typename graph_t>
+auto kruskal(const graph_t& graph, ThreadPool& pool = ThreadPool::shared()) {
+    const auto& csr = graph_detail::as_csr(graph);
+    auto edges = graph_detail::undirected_edges(csr);
+    typedef typename decltype(edges)::value_type edge_t;
+    graph_detail::parallel_sort(edges, [](const edge_t& a, const edge_t& b) { return a < b; }, pool);
+
+    graph_detail::ConcurrentUnionFind sets(csr.size());
+    std::vector<edge_t> chosen;
+    for (const edge_t& edge : edges) {
+        if (chosen.size() + 1 >= csr.size()) {
+            break;
+        }
+        if (sets.unite(edge.u, edge.v)) {
+            chosen.push_back(edge);
+        }
+    }
+    return graph_detail::spanning_forest(csr, chosen);
+}
+
+/*!
+ * \brief Минимальный остовный лес алгоритмом Прима
+ * \details Дерево растёт из очередной непосещённой вершины; ближайшая к дереву вершина берётся из индексированной
+ * кучи с уменьшением ключа, O(m log n). Соседи вершины - концы её исходящих и входящих рёбер снимка, так что
+ * список неориентированных рёбер не строится.
+ * @tparam graph_t - Graph или CsrGraph
+ * @param graph
+ * @return Рёбра леса, суммарный вес и число деревьев.
+ */
+template<typename graph_t>
+auto prim(const graph_t& graph) {
+    const auto& csr = graph_detail::as_csr(graph);
+    typedef typename std::decay<decltype(csr.weight(0))>::type weight_t;
+    const uint32_t NONE = std::numeric_limits<uint32_t>::max();
+    const size_t n = csr.size();
+
+    std::vector<weight_t> best(n);
+    std::vector<uint32_t> via(n, NONE);
+    std::vector<char> in_tree(n, false);
+    IndexedDaryHeap<weight_t> heap;
+    heap.reset(n);
+    std::vector<graph_detail::UndirectedEdge<weight_t>> chosen;
+
+    auto relax = [&](uint32_t u, uint32_t v, const weight_t& weight) {
+        if (!in_tree[v] && (via[v] == NONE || weight < best[v])) {
+            best[v] = weight;
+            via[v] = u;
+            heap.push(v, weight);
+        }
+    };
+
+    for (uint32_t root = 0; root < n; ++root) {
+        if (in_tree[root]) {
+            continue;
+        }
+        heap.push(root, weight_t(0));
+        while (!heap.empty()) {
+            uint32_t u = heap.pop().second;
+            in_tree[u] = true;
+            if (via[u] != NONE) {
+                chosen.push_back({std::min(u, via[u]), std::max(u, via[u]), best[u]});
+            }
+            for (size_t e = csr.edges_begin(u); e < csr.edges_end(u); ++e) {
+                relax(u, csr.target(e), csr.weight(e));
+            }
+            for (size_t e = csr.in_edges_begin(u); e < csr.in_edges_end(u); ++e) {
+                relax(u, csr.source(e), csr.in_weight(e));
+            }
+        }
+    }
+    return graph_detail::spanning_forest(csr, chosen);
+}
+
+/*!
+ * \brief Минимальный остовный лес параллельным алгоритмом Борувки
+ * \details В каждом раунде для каждой компоненты находится самое лёгкое выходящее из неё ребро (рёбра делятся между
+ * потоками, минимум по компоненте обновляется через compare_exchange), затем выбранные рёбра параллельно
+ * объединяют компоненты в ConcurrentUnionFind, и рёбра внутри компонент выбрасываются. Число компонент за раунд
+ * уменьшается хотя бы вдвое, так что раундов не больше log n. Порядок рёбер строгий (вес, u, v), поэтому результат
+ * совпадает с kruskal().
+ * @tparam graph_t - Graph или CsrGraph
+ * @param graph
+ * @param pool - пул потоков (по умолчанию общий)
+ * @return Рёбра леса, суммарный вес и число деревьев.
+ */
+template<typename graph_t>
+auto boruvka(const graph_t& graph, ThreadPool& pool = ThreadPool::shared()) {
+    const auto& csr = graph_detail::as_csr(graph);
+    const auto edges = graph_detail::undirected_edges(csr);
+    typedef typename decltype(edges)::value_type edge_t;
+    const size_t NONE = std::numeric_limits<size_t>::max();
+    const size_t n = csr.size(), grain = size_t(1) << 14;
+
+    // равные рёбра (u -> v и v -> u с одним весом) различаются номером
+    auto before = [&edges](size_t a, size_t b) {
+        return edges[a] < edges[b] || (!(edges[b] < edges[a]) && a < b);
+    };
+
+    graph_detail::ConcurrentUnionFind sets(n);
+    std::vector<std::atomic<size_t>> lightest(n);
+    std::vector<size_t> alive(edges.size());
+    for (size_t e = 0; e < edges.size(); ++e) {
+        alive[e] = e;
+    }
+    std::vector<std::vector<size_t>> local(pool.size());
+    std::vector<edge_t> chosen;
+
+    for (;;) {
+        pool.parallel_for((n + grain - 1) / grain, [&](size_t chunk, size_t) {
+            for (size_t v = chunk * grain; v < std::min(n, (chunk + 1) * grain); ++v) {
+                lightest[v].store(NONE, std::memory_order_relaxed);
+            }
+        });
+
+        // самое лёгкое ребро каждой компоненты (по её корню)
+        pool.parallel_for((alive.size() + grain - 1) / grain, [&](size_t chunk, size_t) {
+            for (size_t k = chunk * grain; k < std::min(alive.size(), (chunk + 1) * grain); ++k) {
+                size_t e = alive[k];
+                uint32_t first = sets.find(edges[e].u), second = sets.find(edges[e].v);
+                if (first == second) {
+                    continue;
+                }
+                for (uint32_t root : {first, second}) {
+                    size_t current = lightest[root].load(std::memory_order_relaxed);
+                    while (current == NONE || before(e, current)) {
+                        if (lightest[root].compare_exchange_weak(current, e, std::memory_order_relaxed)) {
+                            break;
+                        }
+                    }
+                }
+            }
+        });
+
+        // слияние компонент; ребро, выбранное обеими компонентами, unite() примет один раз
+        pool.parallel_for((n + grain - 1) / grain, [&](size_t chunk, size_t worker) {
+            for (size_t v = chunk * grain; v < std::min(n, (chunk + 1) * grain); ++v) {
+                size_t e = lightest[v].load(std::memory_order_relaxed);
+                if (e != NONE && sets.unite(edges[e].u, edges[e].v)) {
+                    local[worker].push_back(e);
+                }
+            }
+        });
+        size_t added = 0;
+        for (std::vector<size_t>& part : local) {
+            for (size_t e : part) {
+                chosen.push_back(edges[e]);
+            }
+            added += part.size();
+            part.clear();
+        }
+        if (added == 0) {
+            break;
+        }
+
+        // рёбра внутри компонент больше не нужны
+        std::vector<std::vector<size_t>> kept((alive.size() + grain - 1) / grain);
+        pool.parallel_for(kept.size(), [&](size_t chunk, size_t) {
+            for (size_t k = chunk * grain; k < std::min(alive.size(), (chunk + 1) * grain); ++k) {
+                if (sets.find(edges[alive[k]].u) != sets.find(edges[alive[k]].v)) {
+                    kept[chunk].push_back(alive[k]);
+                }
+            }
+        });
+        alive.clear();
+        for (const std::vector<size_t>& part : kept) {
+            alive.insert(alive.end(), part.begin(), part.end());
+        }
+    }
+
+    // порядок как у kruskal()
+    std::sort(chosen.begin(), chosen.end());
+    return graph_detail::spanning_forest(csr, chosen);
+}
+
+namespace graph_detail {
+    /*!
+     * \brief Граф из вершин graph и рёбер леса (каждое ребро - в обе стороны)
+     */
+    template<typename result_t, typename graph_t, typename forest_t>
+    result_t forest_graph(const graph_t& graph, const forest_t& forest) {
+        result_t result;
+        for (const auto& [key, node] : graph) {
+            result.insert_node(key, node.value());
+        }
+        for (const auto& edge : forest.edges) {
+            result.insert_edge({edge.from, edge.to}, edge.weight);
+            result.insert_edge({edge.to, edge.from}, edge.weight);
+        }
+        return result;
+    }
+}
+
+/*!
+ * \brief Остовный лес как новый граф: вершины и значения из graph, рёбра леса в обе стороны
+ * @param graph - граф, по которому построен лес
+ * @param forest
+ * @return Граф леса.
+ */
+template<typename key_type, typename value_type, typename weight_type>
+Graph<key_type, value_type, weight_type> forest_graph(const Graph<key_type, value_type, weight_type>& graph,
+                                                      const SpanningForest<key_type, weight_type>& forest) {
+    return graph_detail::forest_graph<Graph<key_type, value_type, weight_type>>(graph, forest);
+}
+
+template<typename key_type, typename value_type, typename weight_type>
+Graph<key_type, value_type, weight_type> forest_graph(const CsrGraph<key_type, value_type, weight_type>& graph,
+                                                      const SpanningForest<key_type, weight_type>& forest) {
+    return graph_detail::forest_graph<Graph<key_type, value_type, weight_type>>(graph, forest);
 }
@@ -0,0 +1,164 @@
+#pragma once
+
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <stdexcept>
+#include <cstdint>
+#include <cstddef>
+#include "Graph.h"
+#include "SparseMatrix.h"
+
+/*!
+ * \brief Какую матрицу строить по графу
+ */
+enum class GraphMatrixKind {
+    adjacency,  // A: A(i, j) - вес ребра i -> j
+    degree,     // D: диагональная, D(i, i) - сумма весов исходящих рёбер i
+    laplacian   // L = D - A
+};
+
+/*!
+ * \brief Матрица графа и соответствие её строк (столбцов) ключам вершин
+ * \details Строка и столбец i отвечают вершине keys[i]; номера те же, что у CSR-снимка графа (ключи по возрастанию),
+ * так что вектор-столбец из n элементов - это значения по вершинам, и результат матричного ядра
+ * (A * x, степени A, собственные векторы L) переводится обратно в ключи через key(i).
+ * @tparam key_type
+ * @tparam T - тип элементов матрицы
+ */
+template<typename key_type, typename T = double>
+struct GraphMatrix {
+    linalg::SparseMatrix<T> matrix;  // n x n, CSR
+    std::vector<key_type> keys;      // keys[i] - ключ вершины i, по возрастанию
+
+    /*!
+     * \brief Число вершин
+     * @return Размер матрицы.
+     */
+    size_t size() const noexcept {
+        return keys.size();
+    }
+
+    /*!
+     * \brief Ключ вершины по номеру строки
+     * @param i
+     * @return Ключ вершины.
+     */
+    const key_type& key(size_t i) const {
+        return keys[i];
+    }
+
+    /*!
+     * \brief Номер строки по ключу вершины
+     * @param key
+     * @return Номер строки (столбца) матрицы.
+     */
+    uint32_t index(const key_type& key) const {
+        return graph_detail::key_index(keys, key);
+    }
+
+    /*!
+     * \brief Плотная копия матрицы (для небольших графов: n * n элементов)
+     * @return linalg::Matrix<T> размера n x n.
+     */
+    linalg::Matrix<T> dense() const {
+        return matrix.to_dense();
+    }
+};
+
+namespace graph_detail {
+    /*!
+     * \brief Строки матрицы графа, заданные вершинами CSR-снимка
+     * \details Строка v: исходящие рёбра v, для degree и laplacian ещё элемент на диагонали. Два прохода по вершинам
+     * (сначала размеры строк, затем заполнение) делятся между потоками общего пула; нули не хранятся.
+     */
+    template<typename T, typename csr_t>
+    linalg::SparseMatrix<T> graph_matrix(const csr_t& csr, GraphMatrixKind kind, bool weighted) {
+        typedef typename csr_t::index_type index_type;
+        const size_t n = csr.size();
+        auto weight = [&csr, weighted](size_t e) {
+            return weighted ? T(csr.weight(e)) : T(1);
+        };
+
+        // fill(v, row, out) пишет элементы строки v в порядке возрастания столбцов и возвращает их число
+        typedef std::vector<std::pair<index_type, T>> row_type;
+        auto fill = [&](index_type v, row_type& row, unsigned* columns, T* values) {
+            row.clear();
+            T degree = 0;
+            for (size_t e = csr.edges_begin(v); e < csr.edges_end(v); ++e) {
+                degree += weight(e);
+                if (kind != GraphMatrixKind::degree) {
+                    row.emplace_back(csr.target(e), kind == GraphMatrixKind::laplacian ? -weight(e) : weight(e));
+                }
+            }
+            if (kind != GraphMatrixKind::adjacency) {
+                row.emplace_back(v, degree);
+            }
+            std::sort(row.begin(), row.end(), [](const std::pair<index_type, T>& a, const std::pair<index_type, T>& b) {
+                return a.first < b.first;
+            });
+
+            size_t count = 0;
+            for (size_t k = 0; k < row.size(); ++k) {
+                T value = row[k].second;
+                // петля v -> v в лапласиане складывается с диагональю
+                while (k + 1 < row.size() && row[k + 1].first == row[k].first) {
+                    value += row[++k].second;
+                }
+                if (value != T(0)) {
+                    if (columns) {
+                        columns[count] = row[k].first;
+                        values[count] = value;
+                    }
+                    ++count;
+                }
+            }
+            return count;
+        };
+
+        std::vector<size_t> offsets(n + 1, 0);
+        size_t average = n ? csr.edge_count() / n + 1 : 1;
+        linalg_detail::parallel_chunks(n, 1024, [&](size_t begin, size_t end) {
+            row_type row;
+            for (size_t v = begin; v < end; ++v) {
+                offsets[v + 1] = fill(static_cast<index_type>(v), row, nullptr, nullptr);
+            }
+        }, average);
+        for (size_t v = 0; v < n; ++v) {
+            offsets[v + 1] += offsets[v];
+        }
+
+        std::vector<unsigned> columns(offsets[n]);
+        std::vector<T> values(offsets[n]);
+        linalg_detail::parallel_chunks(n, 1024, [&](size_t begin, size_t end) {
+            row_type row;
+            for (size_t v = begin; v < end; ++v) {
+                fill(static_cast<index_type>(v), row, columns.data() + offsets[v], values.data() + offsets[v]);
+            }
+        }, average);
+
+        return linalg::SparseMatrix<T>(static_cast<unsigned>(n), static_cast<unsigned>(n), std::move(offsets),
+                                       std::move(columns), std::move(values));
+    }
+}
+
+/*!
+ * \brief Матрица смежности, степеней или лапласиан графа
+ * \details Граф считается ориентированным: A(i, j) - ребро i -> j, степень - по исходящим рёбрам, поэтому у графа,
+ * где каждое ребро записано в обе стороны, A и L симметричны. Вершины нумеруются как в CSR-снимке (ключи по
+ * возрастанию), соответствие номеров ключам возвращается вместе с матрицей. Матрица разреженная (память
+ * O(n + m)); для небольших графов плотная копия - GraphMatrix::dense().
+ * @tparam T - тип элементов матрицы
+ * @tparam graph_t - Graph или CsrGraph
+ * @param graph
+ * @param kind - adjacency, degree или laplacian
+ * @param weighted - true: элементы - веса рёбер (приведённые к T), false: каждое ребро даёт 1
+ * @return Матрица n x n и ключи вершин по номерам строк.
+ */
+template<typename T = double, typename graph_t>
+auto graph_matrix(const graph_t& graph, GraphMatrixKind kind = GraphMatrixKind::adjacency, bool weighted = true) {
+    const auto& csr = graph_detail::as_csr(graph);
+    typedef typename std::decay<decltype(csr.key(0))>::type key_type;
+
+    return GraphMatrix<key_type, T>{graph_detail::graph_matrix<T>(csr, kind, weighted), graph_detail::snapshot_keys(csr)};
+}
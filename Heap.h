@@ -0,0 +1,248 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <limits>
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+#include <functional>
+
+/*!
+ * \brief Двоичная куча с ленивым удалением
+ * \details Очередь с приоритетами для алгоритмов кратчайших путей. Уменьшение ключа не поддерживается:
+ * вершина просто добавляется ещё раз, а устаревшие записи пропускаются при извлечении.
+ * @tparam priority_type
+ */
+template<typename priority_type>
+class BinaryHeap {
+    typedef std::pair<priority_type, uint32_t> entry_type;
+
+    std::vector<entry_type> heap; // двоичная куча с минимумом в heap[0] (std::push_heap / std::pop_heap)
+
+public:
+    /*!
+     * \brief Конструктор
+     * @param n - число вершин (для совместимости с индексированной кучей, не используется)
+     */
+    explicit BinaryHeap(size_t = 0) {}
+
+    /*!
+     * \brief Проверка на пустоту кучи
+     * @return bool - true, если куча пустая, false - иначе.
+     */
+    bool empty() const noexcept {
+        return heap.empty();
+    }
+
+    /*!
+     * \brief Количество записей в куче (с учётом устаревших)
+     * @return Размер кучи.
+     */
+    size_t size() const noexcept {
+        return heap.size();
+    }
+
+    /*!
+     * \brief Вставка вершины (или ещё одной её записи с меньшим приоритетом)
+     * @param index
+     * @param priority
+     */
+    void push(uint32_t index, priority_type priority) {
+        heap.emplace_back(priority, index);
+        std::push_heap(heap.begin(), heap.end(), std::greater<entry_type>());
+    }
+
+    /*!
+     * \brief Минимум без извлечения
+     * @return Пара (приоритет, вершина). Запись может быть устаревшей, её приоритет не больше настоящего минимума.
+     */
+    std::pair<priority_type, uint32_t> top() const {
+        return heap.front();
+    }
+
+    /*!
+     * \brief Извлечение минимума
+     * @return Пара (приоритет, вершина). Запись может быть устаревшей, это проверяет вызывающий.
+     */
+    std::pair<priority_type, uint32_t> pop() {
+        std::pop_heap(heap.begin(), heap.end(), std::greater<entry_type>());
+        entry_type min = heap.back();
+        heap.pop_back();
+        return min;
+    }
+
+    /*!
+     * \brief Очистка кучи (выделенная память сохраняется для следующих запросов)
+     * @param n - число вершин (не используется)
+     */
+    void reset(size_t = 0) {
+        heap.clear();
+    }
+};
+
+/*!
+ * \brief Индексированная d-арная куча с операцией уменьшения ключа
+ * \details Каждая вершина из [0, n) лежит в куче не более одного раза, позиция вершины хранится в массиве,
+ * поэтому push для уже лежащей в куче вершины работает как decrease-key.
+ * @tparam priority_type
+ * @tparam arity - число потомков у узла кучи
+ */
+template<typename priority_type, unsigned arity = 4>
+class IndexedDaryHeap {
+    static_assert(arity >= 2, "heap arity must be at least 2");
+
+    static constexpr uint32_t npos = std::numeric_limits<uint32_t>::max();
+
+    std::vector<uint32_t> heap;                // heap[i] - вершина в i-й ячейке кучи
+    std::vector<priority_type> priorities;     // priorities[i] - приоритет вершины из heap[i]
+    std::vector<uint32_t> position;            // position[v] - ячейка вершины v или npos
+
+    void place(size_t i, uint32_t v, priority_type p) {
+        heap[i] = v;
+        priorities[i] = p;
+        position[v] = static_cast<uint32_t>(i);
+    }
+
+    void sift_up(size_t i, uint32_t v, priority_type p) {
+        while (i > 0) {
+            size_t parent = (i - 1) / arity;
+            if (!(p < priorities[parent])) {
+                break;
+            }
+            place(i, heap[parent], priorities[parent]);
+            i = parent;
+        }
+        place(i, v, p);
+    }
+
+    void sift_down(size_t i, uint32_t v, priority_type p) {
+        size_t n = heap.size();
+        for (;;) {
+            size_t first = i * arity + 1;
+            if (first >= n) {
+                break;
+            }
+            size_t last = std::min(first + arity, n);
+            size_t best = first;
+            for (size_t c = first + 1; c < last; ++c) {
+                if (priorities[c] < priorities[best]) {
+                    best = c;
+                }
+            }
+            if (!(priorities[best] < p)) {
+                break;
+            }
+            place(i, heap[best], priorities[best]);
+            i = best;
+        }
+        place(i, v, p);
+    }
+
+public:
+    /*!
+     * \brief Конструктор
+     * @param n - число вершин
+     */
+    explicit IndexedDaryHeap(size_t n = 0) : position(n, npos) {}
+
+    /*!
+     * \brief Проверка на пустоту кучи
+     * @return bool - true, если куча пустая, false - иначе.
+     */
+    bool empty() const noexcept {
+        return heap.empty();
+    }
+
+    /*!
+     * \brief Количество вершин в куче
+     * @return Размер кучи.
+     */
+    size_t size() const noexcept {
+        return heap.size();
+    }
+
+    /*!
+     * \brief Проверка, лежит ли вершина в куче
+     * @param index
+     * @return bool - true, если вершина в куче, false - иначе.
+     */
+    bool contains(uint32_t index) const {
+        return index < position.size() && position[index] != npos;
+    }
+
+    /*!
+     * \brief Вставка вершины или уменьшение её приоритета
+     * \details Если вершина уже в куче с меньшим или равным приоритетом, ничего не происходит.
+     * @param index
+     * @param priority
+     */
+    void push(uint32_t index, priority_type priority) {
+        if (index >= position.size()) {
+            position.resize(index + 1, npos);
+        }
+
+        if (position[index] == npos) {
+            heap.push_back(index);
+            priorities.push_back(priority);
+            sift_up(heap.size() - 1, index, priority);
+        } else if (priority < priorities[position[index]]) {
+            sift_up(position[index], index, priority);
+        }
+    }
+
+    /*!
+     * \brief Вставка вершины или замена её приоритета (в обе стороны)
+     * @param index
+     * @param priority
+     */
+    void update(uint32_t index, priority_type priority) {
+        if (!contains(index)) {
+            push(index, priority);
+        } else if (priority < priorities[position[index]]) {
+            sift_up(position[index], index, priority);
+        } else {
+            sift_down(position[index], index, priority);
+        }
+    }
+
+    /*!
+     * \brief Минимум без извлечения
+     * @return Пара (приоритет, вершина).
+     */
+    std::pair<priority_type, uint32_t> top() const {
+        return std::pair<priority_type, uint32_t>(priorities[0], heap[0]);
+    }
+
+    /*!
+     * \brief Извлечение минимума
+     * @return Пара (приоритет, вершина).
+     */
+    std::pair<priority_type, uint32_t> pop() {
+        std::pair<priority_type, uint32_t> min(priorities[0], heap[0]);
+        position[min.second] = npos;
+
+        uint32_t last = heap.back();
+        priority_type last_priority = priorities.back();
+        heap.pop_back();
+        priorities.pop_back();
+        if (!heap.empty()) {
+            sift_down(0, last, last_priority);
+        }
+
+        return min;
+    }
+
+    /*!
+     * \brief Очистка кучи
+     * @param n - новое число вершин
+     */
+    void reset(size_t n) {
+        for (uint32_t v : heap) {
+            position[v] = npos;
+        }
+        heap.clear();
+        priorities.clear();
+        position.resize(n, npos);
+    }
+};
@@ -2,7 +2,67 @@
 
 #include <limits>
 #include <iomanip>
+#include <vector>
+#include <cmath>
+#include <type_traits>
 #include "Complex.h"
+#include "Gemm.h"
+#include "MatrixView.h"
+#include "Simd.h"
+
+namespace linalg_detail {
+    /*!
+     * \brief Тип, в котором считается LU-разложение: double для целочисленных матриц, сам T для остальных
+     */
+    template<class T, bool integral = std::is_integral<T>::value>
+    struct lu_value {
+        typedef T type;
+    };
+
+    template<class T>
+    struct lu_value<T, true> {
+        typedef double type;
+    };
+
+    /*!
+     * \brief Перевод результата LU-разложения обратно в T (для целых - с округлением)
+     */
+    template<class T, class value_t>
+    T lu_result(const value_t& value) {
+        if constexpr (std::is_integral<T>::value) {
+            return static_cast<T>(std::llround(value));
+        } else {
+            return static_cast<T>(value);
+        }
+    }
+
+    /*!
+     * \brief Модуль элемента для выбора ведущего элемента (abs находится и для пользовательских типов через ADL)
+     */
+    template<class T>
+    auto magnitude(const T& value) {
+        using std::abs;
+        return abs(value);
+    }
+
+    /*!
+     * \brief Векторная редукция по count элементам на общем пуле: частичные суммы кусков складываются в конце
+     */
+    template<class T>
+    T parallel_reduce(simd::Reduction op, size_t count, const T *x, const T *y = nullptr) {
+        const size_t grain = 1 << 14;
+        std::vector<T> partial(std::max<size_t>(1, (count + grain - 1) / grain), T(0));
+        parallel_chunks(count, grain, [&](size_t begin, size_t end) {
+            partial[begin / grain] = simd::reduce(op, end - begin, x + begin, y ? y + begin : y);
+        });
+
+        T result = 0;
+        for (const T &p : partial) {
+            result += p;
+        }
+        return result;
+    }
+}
 
 /*!
  \brief Пространство имён с шаблонным классом матрицы
@@ -10,6 +70,9 @@
  \details Пространство имён с шаблонным классом матрицы и методами вывода матриц в файлы
 */
 namespace linalg {
+    template<class T>
+    class LU;
+
     /*!
         \brief Шаблонный класс матрицы
 
@@ -17,11 +80,62 @@ namespace linalg {
     */
 
     template<class T = double>
-    class Matrix {
+    class Matrix : public MatrixExpression<Matrix<T>> {
         T *m_ptr;
         unsigned m_rows;
         unsigned m_cols;
+
+        template<class> friend class LU;
+
+        template<class E>
+        using if_expression = typename std::enable_if<std::is_same<typename E::value_type, T>::value>::type;
+
+        /*!
+            \brief Вычисление выражения в уже выделенную память того же размера одним проходом
+         */
+        template<class E, class op_t>
+        void evaluate(const E &expr, op_t op) {
+            linalg_detail::evaluate(m_ptr, m_rows, m_cols, m_cols, 1, expr, op);
+        }
+
+        /*!
+            \brief Поэлементная операция векторным ядром (только для float и double)
+         */
+        void vectorized(linalg_detail::simd::Elementwise op, T alpha, const T *x) {
+            T *data = m_ptr;
+            linalg_detail::parallel_chunks(size_t(m_rows) * m_cols, 1 << 14, [=](size_t begin, size_t end) {
+                linalg_detail::simd::elementwise(op, end - begin, alpha, x ? x + begin : x, data + begin);
+            });
+        }
+
+        /*!
+            \brief *this += expr или *this -= expr
+            \details Матрица и матрица, умноженная на число, прибавляются векторными ядрами (add/sub, axpy),
+            остальные выражения вычисляются общим циклом.
+         */
+        template<class E>
+        void accumulate(const E &expr, bool subtract) {
+            using namespace linalg_detail::simd;
+            linalg_detail::check_same_shape(*this, expr);
+            if (linalg_detail::overlaps(expr, view())) {
+                accumulate(Matrix<T>(expr), subtract);
+                return;
+            }
+
+            if constexpr (is_vectorized<T>::value && std::is_same<E, Matrix<T>>::value) {
+                vectorized(subtract ? Elementwise::sub : Elementwise::add, T(0), expr.m_ptr);
+            } else if constexpr (is_vectorized<T>::value && std::is_same<E, MatrixScaled<Matrix<T>>>::value) {
+                vectorized(Elementwise::axpy, subtract ? -expr.factor() : expr.factor(), expr.expression().m_ptr);
+            } else if (subtract) {
+                evaluate(expr, [](T &x, const T &y) { x -= y; });
+            } else {
+                evaluate(expr, [](T &x, const T &y) { x += y; });
+            }
+        }
+
     public:
+        typedef T value_type;
+
         /*!
             \brief Конструктор по умолчанию
             @param r, c
@@ -61,6 +175,16 @@ namespace linalg {
             other.m_rows = other.m_cols = 0;
         }
 
+        /*!
+         \brief Конструктор из выражения (a + b, k * a, ...): всё выражение вычисляется за один проход
+         @param expr
+         */
+        template<class E, class = if_expression<E>>
+        Matrix(const MatrixExpression<E> &expr) : m_rows(expr.self().rows()), m_cols(expr.self().cols()) {
+            m_ptr = new T[m_rows * m_cols];
+            evaluate(expr.self(), [](T &x, const T &y) { x = y; });
+        }
+
         /*!
          \brief Конструктор конструктор для ситуаций m = {1, 2, 3, 4, 5, 6}
          @param lst
@@ -104,6 +228,45 @@ namespace linalg {
 
         unsigned cols() const { return m_cols; }
 
+        T *data() { return m_ptr; }
+
+        const T *data() const { return m_ptr; }
+
+        /*!
+            \brief Представление всей матрицы (без копирования)
+         */
+        MatrixView<T> view() const {
+            return MatrixView<T>(m_ptr, m_rows, m_cols, m_cols, 1);
+        }
+
+        MatrixSpan<T> span() {
+            return MatrixSpan<T>(m_ptr, m_rows, m_cols, m_cols, 1);
+        }
+
+        /*!
+            \brief Строка, столбец, блок и транспонированная матрица как представления (без копирования)
+            \details Через изменяемые представления можно менять элементы матрицы: m.row(0) = m.row(1) + m.row(2).
+         */
+        MatrixView<T> row(unsigned i) const { return view().row(i); }
+
+        MatrixSpan<T> row(unsigned i) { return span().row(i); }
+
+        MatrixView<T> col(unsigned j) const { return view().col(j); }
+
+        MatrixSpan<T> col(unsigned j) { return span().col(j); }
+
+        MatrixView<T> block(unsigned i, unsigned j, unsigned rows, unsigned cols) const {
+            return view().block(i, j, rows, cols);
+        }
+
+        MatrixSpan<T> block(unsigned i, unsigned j, unsigned rows, unsigned cols) {
+            return span().block(i, j, rows, cols);
+        }
+
+        MatrixView<T> transposed() const { return view().transposed(); }
+
+        MatrixSpan<T> transposed() { return span().transposed(); }
+
 
         /*!
             \brief Перегрузка оператора копирующего присваивания
@@ -149,6 +312,25 @@ namespace linalg {
             return *this;
         }
 
+        /*!
+            \brief Присваивание выражения: при совпадении размеров память матрицы переиспользуется
+            \details Элемент результата зависит только от элементов операндов с тем же индексом,
+            поэтому матрица может входить в правую часть (a = a + b). Если справа есть представление этой же
+            матрицы с другим расположением (a = a.transposed()), выражение вычисляется во временную матрицу.
+            @param expr
+         */
+        template<class E, class = if_expression<E>>
+        Matrix<T> &operator=(const MatrixExpression<E> &expr) {
+            const E &e = expr.self();
+            if (m_rows != e.rows() || m_cols != e.cols() || linalg_detail::overlaps(e, view())) {
+                Matrix<T> tmp(expr);
+                return *this = std::move(tmp);
+            }
+
+            evaluate(e, [](T &x, const T &y) { x = y; });
+            return *this;
+        }
+
 
         /*!
             \brief Доступ к элементам через круглые скобки (вызов функции)
@@ -171,81 +353,36 @@ namespace linalg {
         } // m(1, 1) = 4;
 
         // арифметические операции
-        Matrix<T> operator+=(const Matrix<T> &rhs) {
-            if (m_rows != rhs.m_rows || m_cols != rhs.m_cols) {
-                throw std::logic_error("matrix dimensions are not matching\n");
-            }
-
-            for (int i = 0; i < m_rows; ++i) {
-                for (int j = 0; j < m_cols; ++j) {
-                    m_ptr[i * m_rows + j] += rhs.m_ptr[i * rhs.m_rows + j];
-                }
-            }
+        template<class E, class = if_expression<E>>
+        Matrix<T> &operator+=(const MatrixExpression<E> &rhs) {
+            accumulate(rhs.self(), false);
 
             return *this;
         }
 
-        friend Matrix<T> operator+(Matrix<T> lhs, const Matrix<T> &rhs) {
-            lhs += rhs;
-            return lhs;
-        }
-
-        Matrix<T> operator-=(const Matrix<T> &rhs) {
-            if (m_rows != rhs.m_rows || m_cols != rhs.m_cols) {
-                throw std::logic_error("matrix dimensions are not matching\n");
-            }
-
-            for (int i = 0; i < m_rows; ++i) {
-                for (int j = 0; j < m_cols; ++j) {
-                    m_ptr[i * m_rows + j] -= rhs.m_ptr[i * rhs.m_rows + j];
-                }
-            }
+        template<class E, class = if_expression<E>>
+        Matrix<T> &operator-=(const MatrixExpression<E> &rhs) {
+            accumulate(rhs.self(), true);
 
             return *this;
         }
 
-        friend Matrix<T> operator-(Matrix<T> lhs, const Matrix<T> &rhs) {
-            lhs -= rhs;
-            return lhs;
-        }
-
-        friend Matrix<T> operator*(const Matrix<T> &lhs, const Matrix<T> &rhs) {
-            if (lhs.m_cols != rhs.m_rows) {
-                throw std::logic_error("matrix dimensions are not matching\n");
-            }
-
-            Matrix<T> tmp(lhs.m_rows, rhs.m_cols);
-            for (int i = 0; i < lhs.m_rows; ++i) {
-                for (int j = 0; j < rhs.m_cols; ++j) {
-                    for (int k = 0; k < lhs.m_cols; ++k) {
-                        tmp(i, j) += lhs(i, k) * rhs(k, j);
-                    }
-                }
+        Matrix<T> &operator*=(T k) {
+            if constexpr (linalg_detail::simd::is_vectorized<T>::value) {
+                vectorized(linalg_detail::simd::Elementwise::scale, k, nullptr);
+                return *this;
             }
 
-            return tmp;
-        }
-
-        Matrix<T> &operator*=(T k) {
-            for (int i = 0; i < m_rows; ++i) {
-                for (int j = 0; j < m_cols; ++j) {
-                    m_ptr[i * m_cols + j] *= k;
+            T *data = m_ptr;
+            linalg_detail::parallel_chunks(size_t(m_rows) * m_cols, 1 << 14, [data, &k](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; ++i) {
+                    data[i] *= k;
                 }
-            }
+            });
 
             return *this;
         }
 
-        friend Matrix<T> operator*(T k, Matrix<T> rhs) {
-            rhs *= k;
-            return rhs;
-        }
-
-        friend Matrix<T> operator*(Matrix<T> lhs, T k) {
-            lhs *= k;
-            return lhs;
-        }
-
         // взаимодействие с потоком вывода и оператором <<
         friend std::ostream &operator<<(std::ostream &out, const Matrix<T> &m) {
             for (int i = 0; i < m.m_rows; ++i) {
@@ -280,31 +417,28 @@ namespace linalg {
             }
         }
 
-        T det() const {  // определитель (раскладываем по первой строчке, рекурентно)
+        /*!
+            \brief LU-разложение с выбором ведущего элемента по столбцу
+            @return Объект разложения, по которому можно считать определитель, решать системы и обращать матрицу.
+         */
+        LU<T> lu() const {
+            return LU<T>(*this);
+        }
+
+        /*!
+            \brief Определитель через LU-разложение, O(n^3)
+            \details Для целочисленных матриц разложение считается в double, результат округляется.
+         */
+        T det() const {
             if (m_rows != m_cols) {
                 throw std::logic_error("not a square matrix\n");
             }
 
-            if (m_rows == 1) {
-                return (*this)(0, 0);
-            }
-
-            T d = 0;
-            int sgn = 1;
-            Matrix<T> tmp(m_rows - 1, m_rows - 1);
-            for (int i = 0; i < m_rows; ++i) {
-                getDecreasedMatrix(*this, tmp, 0, i);
-                d += sgn * (*this)(0, i) * tmp.det();
-                sgn *= -1;
-            }
-
-            return d;
+            return linalg_detail::lu_result<T>(lu().det());
         }
 
         friend void row_swap(Matrix<T> &to_swap, int r1, int r2, int c) {  // меняем строчки
-            for (int i = 0; i < c; ++i) {
-                std::swap(to_swap(r1, i), to_swap(r2, i));
-            }
+            swap(to_swap.block(r1, 0, 1, c), to_swap.block(r2, 0, 1, c));
         }
 
         // поиск ранга
@@ -362,29 +496,32 @@ namespace linalg {
         }
 
         // структуры для спецификации вычисления нормы у матрицы с комплексными числами
-        double sqr_abs(T el) {
+        double sqr_abs(T el) const {
             return el * el;
         }
 
 
-        // норма матрицы
-        double norm() {
-            double n = 0;
+        // норма матрицы (Фробениуса)
+        double norm() const {
+            size_t count = size_t(m_rows) * m_cols;
+            if constexpr (linalg_detail::simd::is_vectorized<T>::value) {
+                return sqrt(double(linalg_detail::parallel_reduce(linalg_detail::simd::Reduction::sum_squares, count, m_ptr)));
+            }
 
-            for (int i = 0; i < m_rows; ++i) {
-                for (int j = 0; j < m_cols; ++j) {
-                    n += sqr_abs((*this)[i][j]);
-                }
+            double n = 0;
+            for (size_t i = 0; i < count; ++i) {
+                n += sqr_abs(m_ptr[i]);
             }
 
             return sqrt(n);
         }
 
-        // след матрицы
-        T trace() {
+        // след матрицы (диагональ идёт с шагом m_cols + 1, векторизовать нечего)
+        T trace() const {
             T tr = 0;
-            for (int i = 0; i < std::min(m_rows, m_cols); ++i) {
-                tr += m_ptr[i * m_cols + i];
+            size_t n = std::min(m_rows, m_cols), step = size_t(m_cols) + 1;
+            for (size_t i = 0; i < n; ++i) {
+                tr += m_ptr[i * step];
             }
 
             return tr;
@@ -394,11 +531,22 @@ namespace linalg {
         friend Matrix<T> transpose(const Matrix<T> &m) {
             Matrix<T> tmp(m.m_cols, m.m_rows);
 
-            for (int i = 0; i < m.m_cols; ++i) {
-                for (int j = 0; j < m.m_rows; ++j) {
-                    tmp(i, j) = m(j, i);
+            // блоками 32 x 32, чтобы и чтение, и запись шли по строкам, помещающимся в кэш
+            const size_t block = 32;
+            size_t rows = m.m_rows, cols = m.m_cols;
+            const T *src = m.m_ptr;
+            T *dst = tmp.m_ptr;
+            linalg_detail::parallel_chunks(rows, block, [=](size_t begin, size_t end) {
+                for (size_t i0 = begin; i0 < end; i0 += block) {
+                    for (size_t j0 = 0; j0 < cols; j0 += block) {
+                        for (size_t i = i0; i < std::min(i0 + block, end); ++i) {
+                            for (size_t j = j0; j < std::min(j0 + block, cols); ++j) {
+                                dst[j * rows + i] = src[i * cols + j];
+                            }
+                        }
+                    }
                 }
-            }
+            }, cols);
 
             return tmp;
         }
@@ -411,25 +559,20 @@ namespace linalg {
             if (mat.rows() != res.cols()) {
                 throw std::logic_error("not a square matrix\n");
             }
-            T mat_det = mat.det();
-            for (int i = 0; i < res.rows(); ++i) {
-                for (int j = 0; j < res.cols(); ++j) {
-                    Matrix<T> tmp(mat.rows() - 1, mat.rows() - 1);
-                    getDecreasedMatrix(mat, tmp, i, j);
-                    int sgn = (i + j) % 2 == 0 ? 1 : -1;
-                    res(j, i) = (double) sgn * tmp.det() / mat_det;
+
+            // adj(A) / det(A) = A^-1
+            auto x = mat.lu().inverse();
+            for (unsigned i = 0; i < res.rows(); ++i) {
+                for (unsigned j = 0; j < res.cols(); ++j) {
+                    res(i, j) = (double) x(i, j);
                 }
             }
         }
 
         Matrix<> inv(const Matrix<T> &m) {
-            if (sqr_abs(m.det()) <= std::numeric_limits<double>::epsilon()) {
-                throw std::logic_error("matrix is singular\n");
-            }
-
             Matrix<> res(m.m_rows, m.m_cols);
 
-            Matrix<T> get_adj(m, res);
+            get_adj(m, res);
 
             return res;
         }
@@ -459,4 +602,407 @@ namespace linalg {
             return tmp * tmp;
         }
     };
-}
\ No newline at end of file
+
+    /*!
+        \brief Скалярное произведение матриц одного размера: сумма a(i, j) * b(i, j)
+        \details Для float и double считается векторным ядром на общем пуле потоков.
+        @param a, b
+     */
+    template<class T>
+    T dot(const Matrix<T> &a, const Matrix<T> &b) {
+        linalg_detail::check_same_shape(a, b);
+        size_t count = size_t(a.rows()) * a.cols();
+        if constexpr (linalg_detail::simd::is_vectorized<T>::value) {
+            return linalg_detail::parallel_reduce(linalg_detail::simd::Reduction::dot, count, a.data(), b.data());
+        }
+
+        T result = 0;
+        for (size_t i = 0; i < count; ++i) {
+            result += a.data()[i] * b.data()[i];
+        }
+        return result;
+    }
+
+    /*!
+        \brief LU-разложение квадратной матрицы с выбором ведущего элемента по столбцу: PA = LU
+
+        \details L (единицы на диагонали не хранятся) и U упакованы в одну матрицу, перестановка строк хранится
+        вектором. Разложение строится один раз и переиспользуется для определителя, решения систем с разными
+        правыми частями и обращения. Для целочисленных T вычисления идут в double.
+    */
+    template<class T = double>
+    class LU {
+    public:
+        typedef typename linalg_detail::lu_value<T>::type value_type;
+
+    private:
+        typedef decltype(linalg_detail::magnitude(std::declval<value_type>())) magnitude_type;
+
+        Matrix<value_type> packed;      // под диагональю - L, на и над диагональю - U
+        std::vector<unsigned> rows;     // строка i матрицы PA - это строка rows[i] матрицы A
+        int sign = 1;                   // чётность перестановки
+        bool degenerate = false;        // есть ведущий элемент не больше tolerance
+        magnitude_type tolerance = 0;   // n * eps * max|A|: меньшие ведущие элементы - ошибка округления
+
+        /*!
+            \brief Разложение столбцов [k0, k0 + kb) (панели) по строкам от k0 до конца
+            \details Перестановки применяются к строкам целиком, как в LAPACK getrf. Матрица считается вырожденной,
+            если ведущий элемент не больше tolerance; столбец с нулевым ведущим элементом пропускается.
+         */
+        void factor_panel(unsigned k0, unsigned kb) {
+            unsigned n = packed.m_rows;
+            value_type *a = packed.m_ptr;
+
+            for (unsigned k = k0; k < k0 + kb; ++k) {
+                unsigned p = k;
+                auto best = linalg_detail::magnitude(a[size_t(k) * n + k]);
+                for (unsigned i = k + 1; i < n; ++i) {
+                    auto candidate = linalg_detail::magnitude(a[size_t(i) * n + k]);
+                    if (best < candidate) {
+                        best = candidate;
+                        p = i;
+                    }
+                }
+                if (best <= tolerance) {
+                    degenerate = true;
+                }
+                if (a[size_t(p) * n + k] == value_type(0)) {
+                    continue;
+                }
+                if (p != k) {
+                    std::swap_ranges(a + size_t(k) * n, a + size_t(k + 1) * n, a + size_t(p) * n);
+                    std::swap(rows[k], rows[p]);
+                    sign = -sign;
+                }
+
+                value_type pivot = a[size_t(k) * n + k];
+                for (unsigned i = k + 1; i < n; ++i) {
+                    value_type *row = a + size_t(i) * n;
+                    row[k] /= pivot;
+                    value_type l = row[k];
+                    const value_type *top = a + size_t(k) * n;
+                    for (unsigned j = k + 1; j < k0 + kb; ++j) {
+                        row[j] -= l * top[j];
+                    }
+                }
+            }
+        }
+
+        /*!
+            \brief Прямая и обратная подстановка для правых частей, уже переставленных по rows
+            \details Блоками по 64 строки: вклад уже найденных строк X вычитается умножением матриц (parallel_gemm),
+            внутри блока подстановка идёт построчно.
+         */
+        void substitute(Matrix<value_type> &x) const {
+            const unsigned block = 64;
+            unsigned n = packed.m_rows, m = x.m_cols;
+            const value_type *a = packed.m_ptr;
+            value_type *b = x.m_ptr;
+            std::vector<value_type> minus_a;
+
+            // L Y = B, L - нижняя унитреугольная
+            for (unsigned i0 = 0; i0 < n; i0 += block) {
+                unsigned i1 = std::min(i0 + block, n);
+                if (i0 > 0) {
+                    minus_a.resize(size_t(i1 - i0) * i0);
+                    for (unsigned i = i0; i < i1; ++i) {
+                        for (unsigned k = 0; k < i0; ++k) {
+                            minus_a[size_t(i - i0) * i0 + k] = -a[size_t(i) * n + k];
+                        }
+                    }
+                    linalg_detail::parallel_gemm<value_type>(i1 - i0, m, i0, minus_a.data(), i0, 1, b, m, 1,
+                                                             b + size_t(i0) * m, m);
+                }
+                for (unsigned i = i0; i < i1; ++i) {
+                    value_type *row = b + size_t(i) * m;
+                    for (unsigned k = i0; k < i; ++k) {
+                        value_type l = a[size_t(i) * n + k];
+                        const value_type *above = b + size_t(k) * m;
+                        for (unsigned j = 0; j < m; ++j) {
+                            row[j] -= l * above[j];
+                        }
+                    }
+                }
+            }
+
+            // U X = Y
+            for (unsigned i1 = n; i1 > 0;) {
+                unsigned i0 = i1 > block ? i1 - block : 0;
+                if (i1 < n) {
+                    minus_a.resize(size_t(i1 - i0) * (n - i1));
+                    for (unsigned i = i0; i < i1; ++i) {
+                        for (unsigned k = i1; k < n; ++k) {
+                            minus_a[size_t(i - i0) * (n - i1) + (k - i1)] = -a[size_t(i) * n + k];
+                        }
+                    }
+                    linalg_detail::parallel_gemm<value_type>(i1 - i0, m, n - i1, minus_a.data(), n - i1, 1,
+                                                             b + size_t(i1) * m, m, 1, b + size_t(i0) * m, m);
+                }
+                for (unsigned i = i1; i-- > i0;) {
+                    value_type *row = b + size_t(i) * m;
+                    for (unsigned k = i + 1; k < i1; ++k) {
+                        value_type u = a[size_t(i) * n + k];
+                        const value_type *below = b + size_t(k) * m;
+                        for (unsigned j = 0; j < m; ++j) {
+                            row[j] -= u * below[j];
+                        }
+                    }
+                    value_type pivot = a[size_t(i) * n + i];
+                    for (unsigned j = 0; j < m; ++j) {
+                        row[j] /= pivot;
+                    }
+                }
+                i1 = i0;
+            }
+        }
+
+        /*!
+            \brief Блочное разложение packed на месте
+         */
+        void factor() {
+            unsigned n = packed.m_rows;
+            rows.resize(n);
+            for (unsigned i = 0; i < n; ++i) {
+                rows[i] = i;
+            }
+
+            magnitude_type largest = 0;
+            for (size_t i = 0; i < size_t(n) * n; ++i) {
+                largest = std::max(largest, linalg_detail::magnitude(packed.m_ptr[i]));
+            }
+            tolerance = static_cast<magnitude_type>(n) * std::numeric_limits<magnitude_type>::epsilon() * largest;
+
+            const unsigned block = 64;
+            value_type *a = packed.m_ptr;
+            std::vector<value_type> minus_l;
+            for (unsigned k0 = 0; k0 < n; k0 += block) {
+                unsigned kb = std::min(block, n - k0), rest = n - k0 - kb;
+                factor_panel(k0, kb);
+                if (rest == 0) {
+                    break;
+                }
+
+                // U12 = L11^-1 * A12
+                for (unsigned i = k0 + 1; i < k0 + kb; ++i) {
+                    value_type *row = a + size_t(i) * n;
+                    for (unsigned p = k0; p < i; ++p) {
+                        value_type l = row[p];
+                        const value_type *top = a + size_t(p) * n;
+                        for (unsigned j = k0 + kb; j < n; ++j) {
+                            row[j] -= l * top[j];
+                        }
+                    }
+                }
+
+                // A22 -= L21 * U12
+                minus_l.resize(size_t(rest) * kb);
+                for (unsigned i = 0; i < rest; ++i) {
+                    for (unsigned p = 0; p < kb; ++p) {
+                        minus_l[size_t(i) * kb + p] = -a[size_t(k0 + kb + i) * n + k0 + p];
+                    }
+                }
+                linalg_detail::parallel_gemm<value_type>(rest, rest, kb,
+                                                         minus_l.data(), kb, 1,
+                                                         a + size_t(k0) * n + k0 + kb, n, 1,
+                                                         a + size_t(k0 + kb) * n + k0 + kb, n);
+            }
+        }
+
+        /*!
+            \brief Перестановка строк правых частей на месте: строка i становится строкой rows[i]
+         */
+        void permute(Matrix<value_type> &x) const {
+            unsigned n = packed.m_rows, m = x.m_cols;
+            std::vector<char> done(n, false);
+            std::vector<value_type> first(m);
+            for (unsigned start = 0; start < n; ++start) {
+                if (done[start] || rows[start] == start) {
+                    continue;
+                }
+                // цикл перестановки: start <- rows[start] <- rows[rows[start]] <- ... <- start
+                std::copy(x.m_ptr + size_t(start) * m, x.m_ptr + size_t(start + 1) * m, first.begin());
+                unsigned i = start;
+                while (rows[i] != start) {
+                    std::copy(x.m_ptr + size_t(rows[i]) * m, x.m_ptr + size_t(rows[i] + 1) * m, x.m_ptr + size_t(i) * m);
+                    done[i] = true;
+                    i = rows[i];
+                }
+                std::copy(first.begin(), first.end(), x.m_ptr + size_t(i) * m);
+                done[i] = true;
+            }
+        }
+
+    public:
+        /*!
+            \brief Разложение матрицы
+            \details Блочный алгоритм: панель из 64 столбцов раскладывается построчно, затем считается блок U справа
+            от неё и остаток матрицы обновляется умножением матриц (parallel_gemm). Вырожденность не считается
+            ошибкой: определитель будет нулевым, а solve() и inverse() бросят исключение.
+            @param m - квадратная матрица
+         */
+        explicit LU(const Matrix<T> &m) : packed(m.m_rows, m.m_cols) {
+            if (m.m_rows != m.m_cols) {
+                throw std::logic_error("not a square matrix\n");
+            }
+
+            for (size_t i = 0; i < size_t(m.m_rows) * m.m_cols; ++i) {
+                packed.m_ptr[i] = static_cast<value_type>(m.m_ptr[i]);
+            }
+            factor();
+        }
+
+        /*!
+            \brief Разложение на месте: буфер матрицы m забирается под множители, без копирования
+            @param m - квадратная матрица (после вызова пустая)
+         */
+        template<class U = T, class = typename std::enable_if<std::is_same<U, value_type>::value>::type>
+        explicit LU(Matrix<T> &&m) : packed(0, 0) {
+            if (m.m_rows != m.m_cols) {
+                throw std::logic_error("not a square matrix\n");
+            }
+
+            packed = std::move(m);
+            factor();
+        }
+
+        /*!
+            \brief Порядок матрицы
+         */
+        unsigned size() const {
+            return packed.m_rows;
+        }
+
+        /*!
+            \brief Проверка на вырожденность (ведущий элемент не больше n * eps * max|A|)
+         */
+        bool singular() const {
+            return degenerate;
+        }
+
+        /*!
+            \brief Упакованные множители: под диагональю L (без единичной диагонали), на и над диагональю U
+         */
+        const Matrix<value_type> &factors() const {
+            return packed;
+        }
+
+        /*!
+            \brief Перестановка строк: строка i матрицы PA - это строка permutation()[i] матрицы A
+         */
+        const std::vector<unsigned> &permutation() const {
+            return rows;
+        }
+
+        /*!
+            \brief Определитель: произведение диагонали U со знаком перестановки (ноль, если матрица вырождена)
+         */
+        value_type det() const {
+            if (degenerate) {
+                return value_type(0);
+            }
+            value_type d = static_cast<value_type>(sign);
+            for (unsigned i = 0; i < packed.m_rows; ++i) {
+                d *= packed.m_ptr[size_t(i) * packed.m_cols + i];
+            }
+            return d;
+        }
+
+        /*!
+            \brief Решение системы A X = B
+            @param b - правые части (по столбцу на систему), строк столько же, сколько у A
+            @return Матрица X того же размера, что и b.
+         */
+        template<class U>
+        Matrix<value_type> solve(const Matrix<U> &b) const {
+            if (b.rows() != packed.m_rows) {
+                throw std::logic_error("matrix dimensions are not matching\n");
+            }
+            if (degenerate) {
+                throw std::logic_error("matrix is singular\n");
+            }
+
+            unsigned m = b.cols();
+            Matrix<value_type> x(packed.m_rows, m);
+            for (unsigned i = 0; i < packed.m_rows; ++i) {
+                for (unsigned j = 0; j < m; ++j) {
+                    x.m_ptr[size_t(i) * m + j] = static_cast<value_type>(b(rows[i], j));
+                }
+            }
+            substitute(x);
+            return x;
+        }
+
+        /*!
+            \brief Решение системы A X = B на месте: b заменяется на X
+            @param b - правые части (по столбцу на систему)
+         */
+        void solve_in_place(Matrix<value_type> &b) const {
+            if (b.m_rows != packed.m_rows) {
+                throw std::logic_error("matrix dimensions are not matching\n");
+            }
+            if (degenerate) {
+                throw std::logic_error("matrix is singular\n");
+            }
+
+            permute(b);
+            substitute(b);
+        }
+
+        /*!
+            \brief Обратная матрица: решение A X = E
+         */
+        Matrix<value_type> inverse() const {
+            if (degenerate) {
+                throw std::logic_error("matrix is singular\n");
+            }
+
+            unsigned n = packed.m_rows;
+            Matrix<value_type> x(n, n);
+            for (unsigned i = 0; i < n; ++i) {
+                x.m_ptr[size_t(i) * n + rows[i]] = value_type(1);
+            }
+            substitute(x);
+            return x;
+        }
+    };
+
+    /*!
+        \brief Решение системы A X = B через LU-разложение, O(n^3)
+        @param a - квадратная матрица системы
+        @param b - правые части (по столбцу на систему)
+        @return X (для целочисленных матриц - в double).
+     */
+    template<class T>
+    Matrix<typename LU<T>::value_type> solve(const Matrix<T> &a, const Matrix<T> &b) {
+        return LU<T>(a).solve(b);
+    }
+
+    /*!
+        \brief Решение системы A X = B без лишних копий: разложение строится в буфере a, ответ - в буфере b
+        @return X.
+     */
+    template<class T, class = typename std::enable_if<std::is_same<T, typename LU<T>::value_type>::value>::type>
+    Matrix<T> solve(Matrix<T> &&a, Matrix<T> &&b) {
+        Matrix<T> x(std::move(b));
+        LU<T>(std::move(a)).solve_in_place(x);
+        return x;
+    }
+
+    /*!
+        \brief Обратная матрица через LU-разложение, O(n^3)
+        @param a - квадратная матрица
+        @return A^-1 (для целочисленных матриц - в double).
+     */
+    template<class T>
+    Matrix<typename LU<T>::value_type> inverse(const Matrix<T> &a) {
+        return LU<T>(a).inverse();
+    }
+
+    /*!
+        \brief Обратная матрица, разложение строится в буфере a без копирования
+     */
+    template<class T, class = typename std::enable_if<std::is_same<T, typename LU<T>::value_type>::value>::type>
+    Matrix<T> inverse(Matrix<T> &&a) {
+        return LU<T>(std::move(a)).inverse();
+    }
+}
@@ -0,0 +1,231 @@
+#pragma once
+
+#include <type_traits>
+#include <stdexcept>
+#include <cstddef>
+#include "Gemm.h"
+
+namespace linalg {
+    template<class T>
+    class Matrix;
+
+    template<class T, unsigned R, unsigned C>
+    class FixedMatrix;
+
+    template<class T>
+    class MatrixView;
+
+    /*!
+        \brief Базовый класс (CRTP) для матриц и ленивых поэлементных выражений над ними
+
+        \details a + b, a - b и k * a не вычисляются сразу, а возвращают лёгкий объект-выражение, который хранит
+        операнды и умеет выдавать элемент (i, j) результата. Всё выражение
+        вычисляется за один проход при присваивании в Matrix (или при +=, -=), без временных матриц.
+        Выражение хранит ссылки на матрицы-операнды, поэтому сохранять его дольше самих матриц нельзя:
+        auto e = a + b; допустимо, пока живы a и b.
+        @tparam E - класс-наследник
+     */
+    template<class E>
+    struct MatrixExpression {
+        const E &self() const {
+            return static_cast<const E &>(*this);
+        }
+    };
+
+    /*!
+        \brief Сумма двух выражений
+     */
+    template<class L, class R>
+    class MatrixSum;
+
+    /*!
+        \brief Разность двух выражений
+     */
+    template<class L, class R>
+    class MatrixDifference;
+
+    /*!
+        \brief Выражение, умноженное на число
+     */
+    template<class E>
+    class MatrixScaled;
+}
+
+namespace linalg_detail {
+    /*!
+     * \brief Как выражение хранит операнд: матрицу (Matrix, FixedMatrix) - по ссылке, вложенное выражение - по значению
+     */
+    template<class E>
+    struct expression_operand {
+        typedef const E type;
+    };
+
+    template<class T>
+    struct expression_operand<linalg::Matrix<T>> {
+        typedef const linalg::Matrix<T> &type;
+    };
+
+    template<class T, unsigned R, unsigned C>
+    struct expression_operand<linalg::FixedMatrix<T, R, C>> {
+        typedef const linalg::FixedMatrix<T, R, C> &type;
+    };
+
+    /*!
+     * \brief Элемент (i, j) операнда без проверки индексов: у выражения - через его operator(),
+     * у матриц и представлений - прямо из памяти
+     */
+    template<class E>
+    typename E::value_type element(const E &expr, size_t i, size_t j) {
+        return expr(i, j);
+    }
+
+    template<class T>
+    const T &element(const linalg::Matrix<T> &m, size_t i, size_t j) {
+        return m.data()[i * m.cols() + j];
+    }
+
+    template<class T, unsigned R, unsigned C>
+    constexpr const T &element(const linalg::FixedMatrix<T, R, C> &m, size_t i, size_t j) {
+        return m.data()[i * C + j];
+    }
+
+    template<class T>
+    const T &element(const linalg::MatrixView<T> &m, size_t i, size_t j) {
+        return m.data()[ptrdiff_t(i) * m.row_stride() + ptrdiff_t(j) * m.col_stride()];
+    }
+
+    /*!
+     * \brief Проверка совпадения размеров операндов поэлементной операции
+     */
+    template<class L, class R>
+    void check_same_shape(const L &lhs, const R &rhs) {
+        if (lhs.rows() != rhs.rows() || lhs.cols() != rhs.cols()) {
+            throw std::logic_error("matrix dimensions are not matching\n");
+        }
+    }
+
+    /*!
+     * \brief op(data(i, j), expr(i, j)) для всех элементов: строки делятся между потоками общего пула
+     * \details Приёмник задан указателем и шагами, так что это и матрица, и изменяемое представление.
+     * Для строк, лежащих подряд (col_stride == 1), внутренний цикл векторизуется компилятором.
+     */
+    template<class T, class E, class op_t>
+    void evaluate(T *data, size_t rows, size_t cols, ptrdiff_t row_stride, ptrdiff_t col_stride, const E &expr, op_t op) {
+        size_t grain = std::max<size_t>(1, (size_t(1) << 14) / std::max<size_t>(cols, 1));
+        parallel_chunks(rows, grain, [=, &expr](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                T *row = data + ptrdiff_t(i) * row_stride;
+                if (col_stride == 1) {
+                    for (size_t j = 0; j < cols; ++j) {
+                        op(row[j], element(expr, i, j));
+                    }
+                } else {
+                    for (size_t j = 0; j < cols; ++j) {
+                        op(row[ptrdiff_t(j) * col_stride], element(expr, i, j));
+                    }
+                }
+            }
+        }, cols);
+    }
+}
+
+namespace linalg {
+    template<class L, class R>
+    class MatrixSum : public MatrixExpression<MatrixSum<L, R>> {
+        typename linalg_detail::expression_operand<L>::type lhs;
+        typename linalg_detail::expression_operand<R>::type rhs;
+
+    public:
+        typedef typename L::value_type value_type;
+
+        MatrixSum(const L &l, const R &r) : lhs(l), rhs(r) {
+            linalg_detail::check_same_shape(lhs, rhs);
+        }
+
+        const L &left() const { return lhs; }
+
+        const R &right() const { return rhs; }
+
+        unsigned rows() const { return lhs.rows(); }
+
+        unsigned cols() const { return lhs.cols(); }
+
+        value_type operator()(size_t i, size_t j) const {
+            return linalg_detail::element(lhs, i, j) + linalg_detail::element(rhs, i, j);
+        }
+    };
+
+    template<class L, class R>
+    class MatrixDifference : public MatrixExpression<MatrixDifference<L, R>> {
+        typename linalg_detail::expression_operand<L>::type lhs;
+        typename linalg_detail::expression_operand<R>::type rhs;
+
+    public:
+        typedef typename L::value_type value_type;
+
+        MatrixDifference(const L &l, const R &r) : lhs(l), rhs(r) {
+            linalg_detail::check_same_shape(lhs, rhs);
+        }
+
+        const L &left() const { return lhs; }
+
+        const R &right() const { return rhs; }
+
+        unsigned rows() const { return lhs.rows(); }
+
+        unsigned cols() const { return lhs.cols(); }
+
+        value_type operator()(size_t i, size_t j) const {
+            return linalg_detail::element(lhs, i, j) - linalg_detail::element(rhs, i, j);
+        }
+    };
+
+    template<class E>
+    class MatrixScaled : public MatrixExpression<MatrixScaled<E>> {
+    public:
+        typedef typename E::value_type value_type;
+
+    private:
+        typename linalg_detail::expression_operand<E>::type expr;
+        value_type k;
+
+    public:
+        MatrixScaled(const E &e, const value_type &k) : expr(e), k(k) {}
+
+        const E &expression() const { return expr; }
+
+        const value_type &factor() const { return k; }
+
+        unsigned rows() const { return expr.rows(); }
+
+        unsigned cols() const { return expr.cols(); }
+
+        value_type operator()(size_t i, size_t j) const {
+            return k * linalg_detail::element(expr, i, j);
+        }
+    };
+
+    template<class L, class R>
+    MatrixSum<L, R> operator+(const MatrixExpression<L> &lhs, const MatrixExpression<R> &rhs) {
+        static_assert(std::is_same<typename L::value_type, typename R::value_type>::value,
+                      "matrix element types must match");
+        return MatrixSum<L, R>(lhs.self(), rhs.self());
+    }
+
+    template<class L, class R>
+    MatrixDifference<L, R> operator-(const MatrixExpression<L> &lhs, const MatrixExpression<R> &rhs) {
+        static_assert(std::is_same<typename L::value_type, typename R::value_type>::value,
+                      "matrix element types must match");
+        return MatrixDifference<L, R>(lhs.self(), rhs.self());
+    }
+
+    template<class E>
+    MatrixScaled<E> operator*(const typename E::value_type &k, const MatrixExpression<E> &expr) {
+        return MatrixScaled<E>(expr.self(), k);
+    }
+
+    template<class E>
+    MatrixScaled<E> operator*(const MatrixExpression<E> &expr, const typename E::value_type &k) {
+        return MatrixScaled<E>(expr.self(), k);
+    }
+}
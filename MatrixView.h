@@ -0,0 +1,367 @@
+#pragma once
+
+#include <stdexcept>
+#include <cstddef>
+#include "MatrixExpression.h"
+
+namespace linalg_detail {
+    template<class T>
+    bool overlaps(const linalg::MatrixView<T> &operand, const linalg::MatrixView<T> &target);
+
+    template<class T>
+    bool overlaps(const linalg::Matrix<T> &operand, const linalg::MatrixView<T> &target);
+
+    template<class T, unsigned R, unsigned C>
+    bool overlaps(const linalg::FixedMatrix<T, R, C> &operand, const linalg::MatrixView<T> &target);
+
+    template<class L, class R, class T>
+    bool overlaps(const linalg::MatrixSum<L, R> &operand, const linalg::MatrixView<T> &target);
+
+    template<class L, class R, class T>
+    bool overlaps(const linalg::MatrixDifference<L, R> &operand, const linalg::MatrixView<T> &target);
+
+    template<class E, class T>
+    bool overlaps(const linalg::MatrixScaled<E> &operand, const linalg::MatrixView<T> &target);
+}
+
+namespace linalg {
+    /*!
+        \brief Представление части чужой матрицы без копирования (только чтение)
+
+        \details Хранит указатель на элемент (0, 0), размеры и шаги по строкам и столбцам, поэтому строка, столбец,
+        прямоугольный блок и транспонированная матрица - это то же представление с другими шагами. Представление
+        не владеет памятью: матрица, на которую оно смотрит, должна жить дольше, а изменение её размеров
+        делает представление недействительным. Является выражением: участвует в ленивых a + b, k * a,
+        в произведениях (через gemm с шагами) и неявно превращается в Matrix<T>.
+        @tparam T - тип элементов
+    */
+    template<class T>
+    class MatrixView : public MatrixExpression<MatrixView<T>> {
+    protected:
+        const T *m_ptr;
+        unsigned m_rows;
+        unsigned m_cols;
+        ptrdiff_t m_row_stride;
+        ptrdiff_t m_col_stride;
+
+        void check_block(unsigned i, unsigned j, unsigned rows, unsigned cols) const {
+            if (i > m_rows || j > m_cols || rows > m_rows - i || cols > m_cols - j) {
+                throw std::logic_error("index out of range\n");
+            }
+        }
+
+    public:
+        typedef T value_type;
+
+        /*!
+            \brief Конструктор
+            @param ptr - элемент (0, 0)
+            @param rows, cols
+            @param row_stride, col_stride - расстояние (в элементах) между соседними строками и столбцами
+         */
+        MatrixView(const T *ptr, unsigned rows, unsigned cols, ptrdiff_t row_stride, ptrdiff_t col_stride)
+                : m_ptr(ptr), m_rows(rows), m_cols(cols), m_row_stride(row_stride), m_col_stride(col_stride) {}
+
+        unsigned rows() const { return m_rows; }
+
+        unsigned cols() const { return m_cols; }
+
+        const T *data() const { return m_ptr; }
+
+        ptrdiff_t row_stride() const { return m_row_stride; }
+
+        ptrdiff_t col_stride() const { return m_col_stride; }
+
+        /*!
+            \brief Доступ к элементам через круглые скобки
+            @param i, j
+         */
+        const T &operator()(unsigned i, unsigned j) const {
+            if (i >= m_rows || j >= m_cols) {
+                throw std::logic_error("index out of range\n");
+            }
+            return m_ptr[ptrdiff_t(i) * m_row_stride + ptrdiff_t(j) * m_col_stride];
+        }
+
+        /*!
+            \brief Строка i (1 x cols)
+         */
+        MatrixView row(unsigned i) const {
+            check_block(i, 0, 1, m_cols);
+            return MatrixView(m_ptr + ptrdiff_t(i) * m_row_stride, 1, m_cols, m_row_stride, m_col_stride);
+        }
+
+        /*!
+            \brief Столбец j (rows x 1)
+         */
+        MatrixView col(unsigned j) const {
+            check_block(0, j, m_rows, 1);
+            return MatrixView(m_ptr + ptrdiff_t(j) * m_col_stride, m_rows, 1, m_row_stride, m_col_stride);
+        }
+
+        /*!
+            \brief Блок rows x cols с левым верхним углом (i, j)
+         */
+        MatrixView block(unsigned i, unsigned j, unsigned rows, unsigned cols) const {
+            check_block(i, j, rows, cols);
+            return MatrixView(m_ptr + ptrdiff_t(i) * m_row_stride + ptrdiff_t(j) * m_col_stride, rows, cols,
+                              m_row_stride, m_col_stride);
+        }
+
+        /*!
+            \brief Транспонированная матрица (шаги меняются местами)
+         */
+        MatrixView transposed() const {
+            return MatrixView(m_ptr, m_cols, m_rows, m_col_stride, m_row_stride);
+        }
+
+        // след матрицы
+        T trace() const {
+            T tr = 0;
+            for (unsigned i = 0; i < std::min(m_rows, m_cols); ++i) {
+                tr += m_ptr[ptrdiff_t(i) * (m_row_stride + m_col_stride)];
+            }
+            return tr;
+        }
+    };
+
+    /*!
+        \brief Изменяемое представление части чужой матрицы
+
+        \details То же, что MatrixView, но элементы можно менять. Присваивание выражения (span = expr, span += expr)
+        записывает элементы в исходную матрицу, а не перенацеливает представление; копирование самого
+        MatrixSpan по-прежнему даёт второе представление тех же элементов. Если правая часть перекрывается
+        с изменяемой областью не поэлементно (например, span = span.transposed()), она сначала вычисляется
+        во временную матрицу.
+        @tparam T
+    */
+    template<class T>
+    class MatrixSpan : public MatrixView<T> {
+        using MatrixView<T>::m_ptr;
+        using MatrixView<T>::m_rows;
+        using MatrixView<T>::m_cols;
+        using MatrixView<T>::m_row_stride;
+        using MatrixView<T>::m_col_stride;
+
+        T *mutable_data() const {
+            return const_cast<T *>(m_ptr);  // MatrixSpan строится только из изменяемой памяти
+        }
+
+        template<class E, class op_t>
+        void update(const E &expr, op_t op) {
+            linalg_detail::check_same_shape(*this, expr);
+            if (linalg_detail::overlaps(expr, *this)) {
+                Matrix<T> copy(expr);
+                linalg_detail::evaluate(mutable_data(), m_rows, m_cols, m_row_stride, m_col_stride, copy, op);
+                return;
+            }
+            linalg_detail::evaluate(mutable_data(), m_rows, m_cols, m_row_stride, m_col_stride, expr, op);
+        }
+
+    public:
+        MatrixSpan(T *ptr, unsigned rows, unsigned cols, ptrdiff_t row_stride, ptrdiff_t col_stride)
+                : MatrixView<T>(ptr, rows, cols, row_stride, col_stride) {}
+
+        MatrixSpan(const MatrixSpan &other) = default;
+
+        T *data() const { return mutable_data(); }
+
+        T &operator()(unsigned i, unsigned j) const {
+            return const_cast<T &>(MatrixView<T>::operator()(i, j));
+        }
+
+        MatrixSpan row(unsigned i) const {
+            this->check_block(i, 0, 1, m_cols);
+            return MatrixSpan(data() + ptrdiff_t(i) * m_row_stride, 1, m_cols, m_row_stride, m_col_stride);
+        }
+
+        MatrixSpan col(unsigned j) const {
+            this->check_block(0, j, m_rows, 1);
+            return MatrixSpan(data() + ptrdiff_t(j) * m_col_stride, m_rows, 1, m_row_stride, m_col_stride);
+        }
+
+        MatrixSpan block(unsigned i, unsigned j, unsigned rows, unsigned cols) const {
+            this->check_block(i, j, rows, cols);
+            return MatrixSpan(data() + ptrdiff_t(i) * m_row_stride + ptrdiff_t(j) * m_col_stride, rows, cols,
+                              m_row_stride, m_col_stride);
+        }
+
+        MatrixSpan transposed() const {
+            return MatrixSpan(data(), m_cols, m_rows, m_col_stride, m_row_stride);
+        }
+
+        /*!
+            \brief Запись элементов другого представления того же размера
+            @param rhs
+         */
+        MatrixSpan &operator=(const MatrixSpan &rhs) {
+            update(static_cast<const MatrixView<T> &>(rhs), [](T &x, const T &y) { x = y; });
+            return *this;
+        }
+
+        /*!
+            \brief Запись выражения (матрицы, представления, a + b, ...) того же размера
+            @param expr
+         */
+        template<class E, class = typename std::enable_if<std::is_same<typename E::value_type, T>::value>::type>
+        MatrixSpan &operator=(const MatrixExpression<E> &expr) {
+            update(expr.self(), [](T &x, const T &y) { x = y; });
+            return *this;
+        }
+
+        template<class E, class = typename std::enable_if<std::is_same<typename E::value_type, T>::value>::type>
+        MatrixSpan &operator+=(const MatrixExpression<E> &expr) {
+            update(expr.self(), [](T &x, const T &y) { x += y; });
+            return *this;
+        }
+
+        template<class E, class = typename std::enable_if<std::is_same<typename E::value_type, T>::value>::type>
+        MatrixSpan &operator-=(const MatrixExpression<E> &expr) {
+            update(expr.self(), [](T &x, const T &y) { x -= y; });
+            return *this;
+        }
+
+        MatrixSpan &operator*=(const T &k) {
+            linalg_detail::evaluate(data(), m_rows, m_cols, m_row_stride, m_col_stride,
+                                    static_cast<const MatrixView<T> &>(*this), [k](T &x, const T &) { x *= k; });
+            return *this;
+        }
+
+        /*!
+            \brief Обмен элементами двух представлений одного размера (например, строк одной матрицы)
+         */
+        friend void swap(const MatrixSpan &lhs, const MatrixSpan &rhs) {
+            linalg_detail::check_same_shape(lhs, rhs);
+            for (unsigned i = 0; i < lhs.m_rows; ++i) {
+                for (unsigned j = 0; j < lhs.m_cols; ++j) {
+                    std::swap(lhs(i, j), rhs(i, j));
+                }
+            }
+        }
+    };
+}
+
+namespace linalg_detail {
+    /*!
+     * \brief Операнды, которые gemm читает прямо из памяти (указатель и шаги), без вычисления в Matrix
+     */
+    template<class E>
+    struct strided_access {
+        static constexpr bool value = false;
+    };
+
+    template<class T>
+    struct strided_access<linalg::MatrixView<T>> {
+        static constexpr bool value = true;
+
+        static linalg::MatrixView<T> view(const linalg::MatrixView<T> &v) {
+            return v;
+        }
+    };
+
+    template<class T>
+    struct strided_access<linalg::Matrix<T>> {
+        static constexpr bool value = true;
+
+        static linalg::MatrixView<T> view(const linalg::Matrix<T> &m) {
+            return linalg::MatrixView<T>(m.data(), m.rows(), m.cols(), m.cols(), 1);
+        }
+    };
+
+    template<class T, unsigned R, unsigned C>
+    struct strided_access<linalg::FixedMatrix<T, R, C>> {
+        static constexpr bool value = true;
+
+        static linalg::MatrixView<T> view(const linalg::FixedMatrix<T, R, C> &m) {
+            return linalg::MatrixView<T>(m.data(), R, C, C, 1);
+        }
+    };
+
+    /*!
+     * \brief Адреса первого и последнего (включительно) элементов представления
+     */
+    template<class T>
+    std::pair<const T *, const T *> extent(const linalg::MatrixView<T> &v) {
+        ptrdiff_t rows = ptrdiff_t(v.rows()) - 1, cols = ptrdiff_t(v.cols()) - 1;
+        ptrdiff_t row_span = rows * v.row_stride(), col_span = cols * v.col_stride();
+        return std::make_pair(v.data() + std::min<ptrdiff_t>(row_span, 0) + std::min<ptrdiff_t>(col_span, 0),
+                              v.data() + std::max<ptrdiff_t>(row_span, 0) + std::max<ptrdiff_t>(col_span, 0));
+    }
+
+    /*!
+     * \brief Может ли запись в target испортить ещё не прочитанные элементы операнда
+     * \details Операнд с тем же расположением, что и target, безопасен: элемент (i, j) читается перед записью
+     * того же (i, j). Иначе проверяется пересечение диапазонов адресов.
+     */
+    template<class T>
+    bool overlaps(const linalg::MatrixView<T> &operand, const linalg::MatrixView<T> &target) {
+        if (operand.rows() == 0 || operand.cols() == 0 || target.rows() == 0 || target.cols() == 0) {
+            return false;
+        }
+        if (operand.data() == target.data() && operand.row_stride() == target.row_stride() &&
+            operand.col_stride() == target.col_stride()) {
+            return false;
+        }
+        std::pair<const T *, const T *> a = extent(operand), b = extent(target);
+        return !(a.second < b.first || b.second < a.first);
+    }
+
+    template<class T>
+    bool overlaps(const linalg::Matrix<T> &operand, const linalg::MatrixView<T> &target) {
+        return overlaps(strided_access<linalg::Matrix<T>>::view(operand), target);
+    }
+
+    template<class T, unsigned R, unsigned C>
+    bool overlaps(const linalg::FixedMatrix<T, R, C> &operand, const linalg::MatrixView<T> &target) {
+        return overlaps(strided_access<linalg::FixedMatrix<T, R, C>>::view(operand), target);
+    }
+
+    template<class L, class R, class T>
+    bool overlaps(const linalg::MatrixSum<L, R> &operand, const linalg::MatrixView<T> &target) {
+        return overlaps(operand.left(), target) || overlaps(operand.right(), target);
+    }
+
+    template<class L, class R, class T>
+    bool overlaps(const linalg::MatrixDifference<L, R> &operand, const linalg::MatrixView<T> &target) {
+        return overlaps(operand.left(), target) || overlaps(operand.right(), target);
+    }
+
+    template<class E, class T>
+    bool overlaps(const linalg::MatrixScaled<E> &operand, const linalg::MatrixView<T> &target) {
+        return overlaps(operand.expression(), target);
+    }
+}
+
+namespace linalg {
+    /*!
+        \brief Произведение матриц, представлений и выражений
+        \details Матрицы и представления (в том числе транспонированные и блоки) передаются в gemm указателем
+        и шагами, без копирования; ленивые выражения сначала вычисляются в Matrix.
+        @param lhs, rhs
+        @return Matrix<T>
+     */
+    template<class L, class R>
+    Matrix<typename L::value_type> operator*(const MatrixExpression<L> &lhs, const MatrixExpression<R> &rhs) {
+        typedef typename L::value_type T;
+        static_assert(std::is_same<T, typename R::value_type>::value, "matrix element types must match");
+
+        if constexpr (!linalg_detail::strided_access<L>::value) {
+            return Matrix<T>(lhs) * rhs;
+        } else if constexpr (!linalg_detail::strided_access<R>::value) {
+            return lhs * Matrix<T>(rhs);
+        } else {
+            MatrixView<T> a = linalg_detail::strided_access<L>::view(lhs.self());
+            MatrixView<T> b = linalg_detail::strided_access<R>::view(rhs.self());
+            if (a.cols() != b.rows()) {
+                throw std::logic_error("matrix dimensions are not matching\n");
+            }
+
+            Matrix<T> tmp(a.rows(), b.cols());
+            linalg_detail::parallel_gemm<T>(a.rows(), b.cols(), a.cols(),
+                                            a.data(), a.row_stride(), a.col_stride(),
+                                            b.data(), b.row_stride(), b.col_stride(),
+                                            tmp.data(), tmp.cols());
+            return tmp;
+        }
+    }
+}
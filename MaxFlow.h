@@ -0,0 +1,491 @@
+#pragma once
+
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <stdexcept>
+#include <cstdint>
+#include <cstddef>
+#include "Graph.h"
+
+/*!
+ * \brief Максимальный поток и минимальный разрез
+ * \details Поток задан для каждого ребра графа (в порядке рёбер CSR-снимка), разрез - множеством вершин,
+ * достижимых из истока в остаточной сети: рёбра из этого множества наружу насыщены, и их суммарная пропускная
+ * способность равна величине потока.
+ * @tparam key_type
+ * @tparam weight_type - тип пропускной способности (вес ребра)
+ */
+template<typename key_type, typename weight_type>
+struct MaxFlow {
+    struct Edge {
+        key_type from;
+        key_type to;
+        weight_type capacity;
+        weight_type flow;
+    };
+
+    weight_type value = 0;          // величина потока
+    std::vector<Edge> edges;        // все рёбра графа с потоком по ним
+    std::vector<key_type> keys;     // keys[v] - ключ вершины v
+    std::vector<char> source_side;  // source_side[v] - вершина v по ту же сторону разреза, что исток
+
+    /*!
+     * \brief Сторона разреза
+     * @param key
+     * @return bool - true, если вершина по ту же сторону минимального разреза, что исток, false - иначе.
+     */
+    bool in_source_side(const key_type& key) const {
+        return source_side[graph_detail::key_index(keys, key)];
+    }
+
+    /*!
+     * \brief Рёбра минимального разреза
+     * @return Рёбра из стороны истока в сторону стока.
+     */
+    std::vector<Edge> cut() const {
+        std::vector<Edge> result;
+        for (const Edge& edge : edges) {
+            if (in_source_side(edge.from) && !in_source_side(edge.to)) {
+                result.push_back(edge);
+            }
+        }
+        return result;
+    }
+};
+
+namespace graph_detail {
+    /*!
+     * \brief Остаточная сеть в плоском массиве дуг
+     * \details Каждое ребро u -> v снимка даёт прямую дугу u -> v с остаточной ёмкостью, равной пропускной
+     * способности, и обратную дугу v -> u с нулевой; дуги вершины лежат подряд на отрезке [first[v], first[v + 1]),
+     * rev[a] - парная дуга. Петли дуг не дают (поток по ним всегда 0).
+     * @tparam cap_t
+     */
+    template<typename cap_t>
+    class FlowNetwork {
+    public:
+        static constexpr size_t NONE = std::numeric_limits<size_t>::max();
+
+        size_t n = 0;
+        std::vector<size_t> first;     // начало дуг вершины
+        std::vector<uint32_t> head;    // head[a] - куда идёт дуга
+        std::vector<cap_t> residual;   // остаточная ёмкость дуги
+        std::vector<size_t> rev;       // парная дуга
+        std::vector<size_t> edge_arc;  // прямая дуга ребра e снимка или NONE (петля)
+
+        template<typename csr_t>
+        explicit FlowNetwork(const csr_t& csr) : n(csr.size()), first(csr.size() + 1, 0), edge_arc(csr.edge_count(), NONE) {
+            for (uint32_t u = 0; u < n; ++u) {
+                for (size_t e = csr.edges_begin(u); e < csr.edges_end(u); ++e) {
+                    if (csr.weight(e) < cap_t(0)) {
+                        throw std::logic_error("negative capacity.\n");
+                    }
+                    if (csr.target(e) != u) {
+                        ++first[u + 1];
+                        ++first[csr.target(e) + 1];
+                    }
+                }
+            }
+            for (size_t v = 0; v < n; ++v) {
+                first[v + 1] += first[v];
+            }
+
+            head.resize(first[n]);
+            residual.resize(first[n]);
+            rev.resize(first[n]);
+            std::vector<size_t> next(first.begin(), first.end() - 1);
+            for (uint32_t u = 0; u < n; ++u) {
+                for (size_t e = csr.edges_begin(u); e < csr.edges_end(u); ++e) {
+                    uint32_t v = csr.target(e);
+                    if (v == u) {
+                        continue;
+                    }
+                    size_t a = next[u]++, b = next[v]++;
+                    head[a] = v;
+                    residual[a] = csr.weight(e);
+                    rev[a] = b;
+                    head[b] = u;
+                    residual[b] = 0;
+                    rev[b] = a;
+                    edge_arc[e] = a;
+                }
+            }
+        }
+
+        /*!
+         * \brief Вершины, достижимые из from по дугам с положительной остаточной ёмкостью
+         */
+        std::vector<char> reachable_from(uint32_t from) const {
+            std::vector<char> seen(n, false);
+            std::vector<uint32_t> queue{from};
+            seen[from] = true;
+            for (size_t k = 0; k < queue.size(); ++k) {
+                uint32_t v = queue[k];
+                for (size_t a = first[v]; a < first[v + 1]; ++a) {
+                    if (residual[a] > cap_t(0) && !seen[head[a]]) {
+                        seen[head[a]] = true;
+                        queue.push_back(head[a]);
+                    }
+                }
+            }
+            return seen;
+        }
+    };
+
+    /*!
+     * \brief Проталкивание предпотока (Goldberg-Tarjan) с выбором наивысшей активной вершины
+     * \details Переполненная вершина проталкивает избыток по допустимым дугам (на единицу ниже) и поднимается, когда их
+     * не остаётся. Эвристики:
+     * - глобальная разметка: высоты пересчитываются обходом в ширину от цели по обратным остаточным дугам - в начале
+     *   и после каждых ~6n + m единиц работы (просмотров дуг);
+     * - разрыв: если на высоте k < n не осталось вершин, все вершины выше k больше не доходят до цели и выбывают.
+     * Вершины хранятся в двусвязных списках по высотам (для разрывов) и в стеках активных вершин по высотам.
+     * Выбывшие вершины получают высоту n и не обрабатываются; вершина blocked не участвует в разметке, и в неё
+     * ничего не проталкивается.
+     */
+    template<typename cap_t>
+    class PushRelabel {
+        FlowNetwork<cap_t>& net;
+        std::vector<cap_t>& excess;
+        const size_t n;
+        std::vector<uint32_t> height;
+        std::vector<size_t> current;                            // текущая дуга вершины
+        std::vector<uint32_t> next_node, prev_node, first_node;  // все вершины по высотам (< n)
+        std::vector<uint32_t> next_active, first_active;         // активные вершины по высотам
+        size_t max_active = 0, max_height = 0;
+
+        static constexpr uint32_t END = std::numeric_limits<uint32_t>::max();
+
+        void insert(uint32_t v) {
+            uint32_t h = height[v];
+            prev_node[v] = END;
+            next_node[v] = first_node[h];
+            if (first_node[h] != END) {
+                prev_node[first_node[h]] = v;
+            }
+            first_node[h] = v;
+            max_height = std::max<size_t>(max_height, h);
+        }
+
+        void erase(uint32_t v) {
+            uint32_t h = height[v];
+            if (prev_node[v] != END) {
+                next_node[prev_node[v]] = next_node[v];
+            } else {
+                first_node[h] = next_node[v];
+            }
+            if (next_node[v] != END) {
+                prev_node[next_node[v]] = prev_node[v];
+            }
+        }
+
+        void activate(uint32_t v) {
+            next_active[v] = first_active[height[v]];
+            first_active[height[v]] = v;
+            max_active = std::max<size_t>(max_active, height[v]);
+        }
+
+        /*!
+         * \brief Точные высоты: расстояние до target в остаточной сети (недостижимые - n)
+         */
+        void global_relabel(uint32_t target, uint32_t blocked) {
+            std::fill(height.begin(), height.end(), uint32_t(n));
+            std::fill(first_node.begin(), first_node.end(), END);
+            std::fill(first_active.begin(), first_active.end(), END);
+            max_active = max_height = 0;
+
+            std::vector<uint32_t> queue{target};
+            height[target] = 0;
+            for (size_t k = 0; k < queue.size(); ++k) {
+                uint32_t v = queue[k];
+                for (size_t a = net.first[v]; a < net.first[v + 1]; ++a) {
+                    uint32_t u = net.head[a];
+                    if (u != blocked && height[u] == n && net.residual[net.rev[a]] > cap_t(0)) {
+                        height[u] = height[v] + 1;
+                        queue.push_back(u);
+                    }
+                }
+            }
+            for (uint32_t v : queue) {
+                current[v] = net.first[v];
+                insert(v);
+                if (v != target && excess[v] > cap_t(0)) {
+                    activate(v);
+                }
+            }
+        }
+
+        /*!
+         * \brief Разрыв на высоте k: вершины выше k выбывают
+         */
+        void gap(size_t k) {
+            for (size_t h = k + 1; h <= max_height; ++h) {
+                for (uint32_t v = first_node[h]; v != END; v = next_node[v]) {
+                    height[v] = uint32_t(n);
+                }
+                first_node[h] = END;
+                first_active[h] = END;
+            }
+            max_height = k;
+        }
+
+        /*!
+         * \brief Проталкивание всего избытка вершины v (с подъёмами)
+         * @return Число просмотренных дуг.
+         */
+        size_t discharge(uint32_t v, uint32_t target) {
+            size_t work = 0;
+            while (excess[v] > cap_t(0)) {
+                size_t end = net.first[v + 1];
+                for (; current[v] < end && excess[v] > cap_t(0); ++current[v]) {
+                    ++work;
+                    size_t a = current[v];
+                    uint32_t w = net.head[a];
+                    if (net.residual[a] > cap_t(0) && height[w] + 1 == height[v]) {
+                        cap_t delta = std::min(excess[v], net.residual[a]);
+                        net.residual[a] -= delta;
+                        net.residual[net.rev[a]] += delta;
+                        if (w != target && excess[w] == cap_t(0)) {
+                            activate(w);
+                        }
+                        excess[v] -= delta;
+                        excess[w] += delta;
+                        if (excess[v] == cap_t(0)) {
+                            return work;
+                        }
+                    }
+                }
+
+                // подъём: на единицу выше самого низкого соседа по остаточной дуге
+                size_t old = height[v], lowest = n;
+                for (size_t a = net.first[v]; a < end; ++a) {
+                    ++work;
+                    if (net.residual[a] > cap_t(0)) {
+                        lowest = std::min<size_t>(lowest, height[net.head[a]] + 1);
+                    }
+                }
+                erase(v);
+                if (first_node[old] == END) {
+                    height[v] = uint32_t(n);
+                    gap(old);
+                    return work;
+                }
+                height[v] = uint32_t(std::min(lowest, n));
+                if (height[v] == n) {
+                    return work;
+                }
+                current[v] = net.first[v];
+                insert(v);
+            }
+            return work;
+        }
+
+    public:
+        PushRelabel(FlowNetwork<cap_t>& net, std::vector<cap_t>& excess)
+                : net(net), excess(excess), n(net.n), height(n, uint32_t(n)), current(n), next_node(n), prev_node(n),
+                  first_node(n + 1, END), next_active(n), first_active(n + 1, END) {}
+
+        /*!
+         * \brief Проталкивание избытков в target, пока это возможно
+         */
+        void run(uint32_t target, uint32_t blocked) {
+            const size_t period = 6 * n + net.head.size() / 2;
+            global_relabel(target, blocked);
+            size_t work = 0;
+            for (;;) {
+                while (max_active > 0 && first_active[max_active] == END) {
+                    --max_active;
+                }
+                if (first_active[max_active] == END) {
+                    return;
+                }
+                uint32_t v = first_active[max_active];
+                first_active[max_active] = next_active[v];
+                // вершина могла выбыть (разрыв) или попасть в стек повторно
+                if (height[v] != max_active || excess[v] == cap_t(0)) {
+                    continue;
+                }
+                work += discharge(v, target);
+                if (work > period) {
+                    global_relabel(target, blocked);
+                    work = 0;
+                }
+            }
+        }
+    };
+
+    /*!
+     * \brief Максимальный поток проталкиванием предпотока
+     * \details Первая фаза: из истока насыщаются все дуги, избытки проталкиваются к стоку; остаток избытка - в
+     * вершинах, от которых сток недостижим. Вторая фаза: те же проталкивания с целью "исток" (сток закрыт) возвращают
+     * остаток в исток, и предпоток становится потоком.
+     */
+    template<typename cap_t>
+    cap_t push_relabel(FlowNetwork<cap_t>& net, uint32_t source, uint32_t sink) {
+        std::vector<cap_t> excess(net.n, cap_t(0));
+        for (size_t a = net.first[source]; a < net.first[source + 1]; ++a) {
+            cap_t delta = net.residual[a];
+            net.residual[a] = 0;
+            net.residual[net.rev[a]] += delta;
+            excess[net.head[a]] += delta;
+        }
+        excess[source] = 0;
+
+        PushRelabel<cap_t> engine(net, excess);
+        engine.run(sink, source);
+        cap_t value = excess[sink];
+        excess[sink] = 0;
+        engine.run(source, sink);
+        return value;
+    }
+
+    /*!
+     * \brief Максимальный поток алгоритмом Диница
+     * \details Фаза: обход в ширину от истока размечает уровни, затем блокирующий поток ищется поиском в глубину по
+     * дугам на уровень выше. Поиск в глубину итеративный (стек дуг текущего пути), с указателем текущей дуги у каждой
+     * вершины; тупиковая вершина исключается до конца фазы.
+     */
+    template<typename cap_t>
+    cap_t dinic(FlowNetwork<cap_t>& net, uint32_t source, uint32_t sink) {
+        const uint32_t NONE = std::numeric_limits<uint32_t>::max();
+        std::vector<uint32_t> level(net.n), queue;
+        std::vector<size_t> current(net.n), path;
+        cap_t value = 0;
+
+        for (;;) {
+            std::fill(level.begin(), level.end(), NONE);
+            queue.assign(1, source);
+            level[source] = 0;
+            for (size_t k = 0; k < queue.size() && level[sink] == NONE; ++k) {
+                uint32_t v = queue[k];
+                for (size_t a = net.first[v]; a < net.first[v + 1]; ++a) {
+                    if (net.residual[a] > cap_t(0) && level[net.head[a]] == NONE) {
+                        level[net.head[a]] = level[v] + 1;
+                        queue.push_back(net.head[a]);
+                    }
+                }
+            }
+            if (level[sink] == NONE) {
+                return value;
+            }
+
+            std::copy(net.first.begin(), net.first.end() - 1, current.begin());
+            path.clear();
+            uint32_t v = source;
+            for (;;) {
+                if (v == sink) {
+                    cap_t delta = net.residual[path[0]];
+                    for (size_t a : path) {
+                        delta = std::min(delta, net.residual[a]);
+                    }
+                    // откат к началу первой насыщенной дуги
+                    size_t keep = path.size();
+                    for (size_t k = 0; k < path.size(); ++k) {
+                        net.residual[path[k]] -= delta;
+                        net.residual[net.rev[path[k]]] += delta;
+                        if (keep == path.size() && net.residual[path[k]] == cap_t(0)) {
+                            keep = k;
+                        }
+                    }
+                    value += delta;
+                    path.resize(keep);
+                    v = path.empty() ? source : net.head[path.back()];
+                    continue;
+                }
+
+                size_t& a = current[v];
+                while (a < net.first[v + 1]
+                       && !(net.residual[a] > cap_t(0) && level[net.head[a]] == level[v] + 1)) {
+                    ++a;
+                }
+                if (a < net.first[v + 1]) {
+                    path.push_back(a);
+                    v = net.head[a];
+                    continue;
+                }
+
+                // тупик
+                level[v] = NONE;
+                if (path.empty()) {
+                    break;
+                }
+                v = net.head[net.rev[path.back()]];
+                path.pop_back();
+                ++current[v];
+            }
+        }
+    }
+
+    /*!
+     * \brief Поток по рёбрам снимка и разрез по готовой остаточной сети
+     */
+    template<typename csr_t, typename cap_t>
+    auto flow_result(const csr_t& csr, const FlowNetwork<cap_t>& net, uint32_t source, cap_t value) {
+        typedef typename std::decay<decltype(csr.key(0))>::type key_type;
+
+        MaxFlow<key_type, cap_t> result;
+        result.value = value;
+        result.keys = snapshot_keys(csr);
+        result.source_side = net.reachable_from(source);
+        result.edges.reserve(csr.edge_count());
+        for (uint32_t u = 0; u < csr.size(); ++u) {
+            for (size_t e = csr.edges_begin(u); e < csr.edges_end(u); ++e) {
+                size_t a = net.edge_arc[e];
+                cap_t flow = a == FlowNetwork<cap_t>::NONE ? cap_t(0) : csr.weight(e) - net.residual[a];
+                result.edges.push_back({csr.key(u), csr.key(csr.target(e)), csr.weight(e), flow});
+            }
+        }
+        return result;
+    }
+}
+
+/*!
+ * \brief Максимальный поток из key_source в key_sink (проталкивание предпотока)
+ * \details Веса рёбер - пропускные способности (неотрицательные). Остаточная сеть строится один раз в плоском массиве
+ * дуг (graph_detail::FlowNetwork); проталкивание с наивысшей меткой, глобальной разметкой и разрывами - см.
+ * graph_detail::push_relabel.
+ * @tparam graph_t - Graph или CsrGraph
+ * @tparam node_name_t
+ * @param graph
+ * @param key_source
+ * @param key_sink
+ * @return Величина потока, поток по каждому ребру и минимальный разрез.
+ */
+template<typename graph_t, typename node_name_t>
+auto max_flow(const graph_t& graph, const node_name_t& key_source, const node_name_t& key_sink) {
+    const auto& csr = graph_detail::as_csr(graph);
+    typedef typename std::decay<decltype(csr.weight(0))>::type cap_t;
+    uint32_t source = csr.index(key_source), sink = csr.index(key_sink);
+    if (source == sink) {
+        throw std::logic_error("source and sink must differ.\n");
+    }
+
+    graph_detail::FlowNetwork<cap_t> net(csr);
+    cap_t value = graph_detail::push_relabel(net, source, sink);
+    return graph_detail::flow_result(csr, net, source, value);
+}
+
+/*!
+ * \brief Максимальный поток из key_source в key_sink (алгоритм Диница)
+ * \details Та же остаточная сеть, что у max_flow(); удобен на графах с небольшими ёмкостями и короткими путями.
+ * @tparam graph_t - Graph или CsrGraph
+ * @tparam node_name_t
+ * @param graph
+ * @param key_source
+ * @param key_sink
+ * @return Величина потока, поток по каждому ребру и минимальный разрез.
+ */
+template<typename graph_t, typename node_name_t>
+auto dinic(const graph_t& graph, const node_name_t& key_source, const node_name_t& key_sink) {
+    const auto& csr = graph_detail::as_csr(graph);
+    typedef typename std::decay<decltype(csr.weight(0))>::type cap_t;
+    uint32_t source = csr.index(key_source), sink = csr.index(key_sink);
+    if (source == sink) {
+        throw std::logic_error("source and sink must differ.\n");
+    }
+
+    graph_detail::FlowNetwork<cap_t> net(csr);
+    cap_t value = graph_detail::dinic(net, source, sink);
+    return graph_detail::flow_result(csr, net, source, value);
+}
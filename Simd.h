@@ -0,0 +1,278 @@
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define LINALG_SIMD_DISPATCH 1
+#define LINALG_SIMD_TARGET(isa) __attribute__((target(isa)))
+#define LINALG_SIMD_INLINE __attribute__((always_inline)) inline
+#else
+#define LINALG_SIMD_DISPATCH 0
+#define LINALG_SIMD_TARGET(isa)
+#define LINALG_SIMD_INLINE inline
+#endif
+
+/*!
+ \brief Векторные ядра для float и double с выбором набора инструкций во время выполнения
+*/
+namespace linalg_detail {
+    namespace simd {
+        /*!
+         * \brief Набор инструкций, под который собрано ядро
+         */
+        enum class Level {
+            scalar,
+            sse2,
+            avx2,
+            avx512
+        };
+
+        /*!
+         * \brief Поэлементные операции над y (x - второй операнд, alpha - число)
+         */
+        enum class Elementwise {
+            add,    // y += x
+            sub,    // y -= x
+            scale,  // y *= alpha
+            axpy    // y += alpha * x
+        };
+
+        /*!
+         * \brief Редукции
+         */
+        enum class Reduction {
+            dot,          // сумма x[i] * y[i]
+            sum_squares   // сумма x[i] * x[i]
+        };
+
+        template<class T>
+        struct is_vectorized : std::integral_constant<bool, std::is_same<T, float>::value || std::is_same<T, double>::value> {};
+
+        /*!
+         * \brief Лучший набор инструкций, который поддерживает процессор
+         */
+        inline Level detect() {
+#if LINALG_SIMD_DISPATCH
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx512f")) {
+                return Level::avx512;
+            }
+            if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+                return Level::avx2;
+            }
+            if (__builtin_cpu_supports("sse2")) {
+                return Level::sse2;
+            }
+#endif
+            return Level::scalar;
+        }
+
+        /*!
+         * \brief Набор инструкций, которым пользуются ядра (определяется один раз)
+         * \details Можно понизить для сравнения (benchmark.cpp); повышать выше detect() нельзя.
+         */
+        inline Level &active_level() {
+            static Level level = detect();
+            return level;
+        }
+
+        /*!
+         * \brief Последовательная поэлементная операция (без векторизации и для хвостов векторных ядер)
+         */
+        template<class T>
+        void elementwise_scalar(Elementwise op, size_t n, T alpha, const T *x, T *y) {
+            for (size_t i = 0; i < n; ++i) {
+                switch (op) {
+                    case Elementwise::add:
+                        y[i] += x[i];
+                        break;
+                    case Elementwise::sub:
+                        y[i] -= x[i];
+                        break;
+                    case Elementwise::scale:
+                        y[i] *= alpha;
+                        break;
+                    case Elementwise::axpy:
+                        y[i] += alpha * x[i];
+                        break;
+                }
+            }
+        }
+
+        /*!
+         * \brief Последовательная редукция
+         */
+        template<class T>
+        T reduction_scalar(Reduction op, size_t n, const T *x, const T *y) {
+            const T *other = op == Reduction::sum_squares ? x : y;
+            T result = 0;
+            for (size_t i = 0; i < n; ++i) {
+                result += x[i] * other[i];
+            }
+            return result;
+        }
+
+#if LINALG_SIMD_DISPATCH
+        /*!
+         * \brief Тело поэлементной операции для векторов из width байт
+         * \details Векторы - расширение GCC/Clang (vector_size): компилятор переводит их в команды того набора
+         * инструкций, под который собрана вызывающая функция. Загрузка и запись через memcpy не требуют выравнивания.
+         */
+        template<Elementwise op, class T, size_t width>
+        LINALG_SIMD_INLINE void elementwise_loop(size_t n, T alpha, const T *x, T *y) {
+            typedef T vector_type __attribute__((vector_size(width)));
+            constexpr size_t lanes = width / sizeof(T);
+            vector_type a = vector_type{} + alpha;
+            size_t i = 0;
+            for (; i + lanes <= n; i += lanes) {
+                vector_type vx, vy;
+                std::memcpy(&vy, y + i, sizeof vy);
+                if (op != Elementwise::scale) {
+                    std::memcpy(&vx, x + i, sizeof vx);
+                }
+                if (op == Elementwise::add) {
+                    vy += vx;
+                } else if (op == Elementwise::sub) {
+                    vy -= vx;
+                } else if (op == Elementwise::scale) {
+                    vy *= a;
+                } else {
+                    vy += a * vx;
+                }
+                std::memcpy(y + i, &vy, sizeof vy);
+            }
+            elementwise_scalar(op, n - i, alpha, op == Elementwise::scale ? x : x + i, y + i);
+        }
+
+        template<class T, size_t width>
+        LINALG_SIMD_INLINE void elementwise_body(Elementwise op, size_t n, T alpha, const T *x, T *y) {
+            switch (op) {
+                case Elementwise::add:
+                    return elementwise_loop<Elementwise::add, T, width>(n, alpha, x, y);
+                case Elementwise::sub:
+                    return elementwise_loop<Elementwise::sub, T, width>(n, alpha, x, y);
+                case Elementwise::scale:
+                    return elementwise_loop<Elementwise::scale, T, width>(n, alpha, x, y);
+                case Elementwise::axpy:
+                    return elementwise_loop<Elementwise::axpy, T, width>(n, alpha, x, y);
+            }
+        }
+
+        /*!
+         * \brief Тело редукции: четыре независимых векторных сумматора, чтобы не ждать задержку сложения
+         */
+        template<class T, size_t width>
+        LINALG_SIMD_INLINE T reduction_body(Reduction op, size_t n, const T *x, const T *y) {
+            typedef T vector_type __attribute__((vector_size(width)));
+            constexpr size_t lanes = width / sizeof(T);
+            if (op == Reduction::sum_squares) {
+                y = x;
+            }
+            vector_type acc[4] = {};
+            size_t i = 0;
+            for (; i + 4 * lanes <= n; i += 4 * lanes) {
+                for (size_t u = 0; u < 4; ++u) {
+                    vector_type vx, vy;
+                    std::memcpy(&vx, x + i + u * lanes, sizeof vx);
+                    std::memcpy(&vy, y + i + u * lanes, sizeof vy);
+                    acc[u] += vx * vy;
+                }
+            }
+            vector_type total = (acc[0] + acc[1]) + (acc[2] + acc[3]);
+            T result = 0;
+            for (size_t l = 0; l < lanes; ++l) {
+                result += total[l];
+            }
+            return result + reduction_scalar(Reduction::dot, n - i, x + i, y + i);
+        }
+
+        template<class T>
+        LINALG_SIMD_TARGET("sse2") void elementwise_sse2(Elementwise op, size_t n, T alpha, const T *x, T *y) {
+            elementwise_body<T, 16>(op, n, alpha, x, y);
+        }
+
+        template<class T>
+        LINALG_SIMD_TARGET("avx2,fma") void elementwise_avx2(Elementwise op, size_t n, T alpha, const T *x, T *y) {
+            elementwise_body<T, 32>(op, n, alpha, x, y);
+        }
+
+        template<class T>
+        LINALG_SIMD_TARGET("avx512f") void elementwise_avx512(Elementwise op, size_t n, T alpha, const T *x, T *y) {
+            elementwise_body<T, 64>(op, n, alpha, x, y);
+        }
+
+        template<class T>
+        LINALG_SIMD_TARGET("sse2") T reduction_sse2(Reduction op, size_t n, const T *x, const T *y) {
+            return reduction_body<T, 16>(op, n, x, y);
+        }
+
+        template<class T>
+        LINALG_SIMD_TARGET("avx2,fma") T reduction_avx2(Reduction op, size_t n, const T *x, const T *y) {
+            return reduction_body<T, 32>(op, n, x, y);
+        }
+
+        template<class T>
+        LINALG_SIMD_TARGET("avx512f") T reduction_avx512(Reduction op, size_t n, const T *x, const T *y) {
+            return reduction_body<T, 64>(op, n, x, y);
+        }
+#endif
+
+        /*!
+         * \brief Поэлементная операция над массивами длины n ядром для active_level()
+         * @param op
+         * @param n
+         * @param alpha - число для scale и axpy
+         * @param x - второй операнд (для scale не читается, может быть nullptr)
+         * @param y - изменяемый массив
+         */
+        template<class T>
+        void elementwise(Elementwise op, size_t n, T alpha, const T *x, T *y) {
+            static_assert(is_vectorized<T>::value, "SIMD kernels are provided for float and double only");
+#if LINALG_SIMD_DISPATCH
+            switch (active_level()) {
+                case Level::avx512:
+                    return elementwise_avx512(op, n, alpha, x, y);
+                case Level::avx2:
+                    return elementwise_avx2(op, n, alpha, x, y);
+                case Level::sse2:
+                    return elementwise_sse2(op, n, alpha, x, y);
+                case Level::scalar:
+                    break;
+            }
+#endif
+            elementwise_scalar(op, n, alpha, x, y);
+        }
+
+        /*!
+         * \brief Редукция массивов длины n ядром для active_level()
+         * \details Векторные ядра суммируют в другом порядке, чем последовательный цикл, поэтому результат может
+         * отличаться от него в последних знаках.
+         * @param op
+         * @param n
+         * @param x
+         * @param y - второй массив для dot (для sum_squares не читается)
+         */
+        template<class T>
+        T reduce(Reduction op, size_t n, const T *x, const T *y = nullptr) {
+            static_assert(is_vectorized<T>::value, "SIMD kernels are provided for float and double only");
+#if LINALG_SIMD_DISPATCH
+            switch (active_level()) {
+                case Level::avx512:
+                    return reduction_avx512(op, n, x, y);
+                case Level::avx2:
+                    return reduction_avx2(op, n, x, y);
+                case Level::sse2:
+                    return reduction_sse2(op, n, x, y);
+                case Level::scalar:
+                    break;
+            }
+#endif
+            return reduction_scalar(op, n, x, y);
+        }
+    }
+}
+
+#undef LINALG_SIMD_TARGET
+#undef LINALG_SIMD_INLINE
@@ -0,0 +1,383 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+#include <iomanip>
+#include <cstddef>
+#include "Matrix.h"
+
+namespace linalg {
+    /*!
+        \brief Способ хранения разреженной матрицы
+     */
+    enum class SparseLayout {
+        csr,  // по строкам: offsets[i]..offsets[i + 1] - ненулевые элементы строки i, indices - их столбцы
+        csc   // по столбцам: offsets[j]..offsets[j + 1] - ненулевые элементы столбца j, indices - их строки
+    };
+
+    /*!
+        \brief Разреженная матрица в формате CSR или CSC
+
+        \details Хранятся только ненулевые элементы: смещения (outer + 1 штук), индексы и значения (по штуке
+        на элемент), т.е. память O(rows + nnz) вместо O(rows * cols) у Matrix. Внутри строки (столбца)
+        элементы упорядочены по индексу, повторов нет. Умножение на плотную матрицу (в том числе на столбец -
+        SpMV) идёт параллельно на общем пуле; для умножения удобнее CSR, CSC выгоднее для A^T и обхода столбцов.
+        @tparam T - тип элементов
+    */
+    template<class T = double>
+    class SparseMatrix {
+    public:
+        /*!
+            \brief Элемент для построения матрицы: (строка, столбец, значение)
+         */
+        struct Entry {
+            unsigned row;
+            unsigned col;
+            T value;
+        };
+
+    private:
+        unsigned m_rows;
+        unsigned m_cols;
+        SparseLayout m_layout;
+        std::vector<size_t> m_offsets;
+        std::vector<unsigned> m_indices;
+        std::vector<T> m_values;
+
+        unsigned outer_size() const {
+            return m_layout == SparseLayout::csr ? m_rows : m_cols;
+        }
+
+        unsigned inner_size() const {
+            return m_layout == SparseLayout::csr ? m_cols : m_rows;
+        }
+
+        /*!
+            \brief Та же матрица в другом формате: перестановка подсчётом, O(rows + cols + nnz)
+            \details Внешние индексы обходятся по возрастанию, поэтому внутри новых строк (столбцов) порядок сохраняется.
+         */
+        SparseMatrix relayout() const {
+            SparseMatrix result(m_rows, m_cols, m_layout == SparseLayout::csr ? SparseLayout::csc : SparseLayout::csr);
+            std::vector<size_t> &offsets = result.m_offsets;
+            for (unsigned index : m_indices) {
+                ++offsets[index + 1];
+            }
+            std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+
+            result.m_indices.resize(m_indices.size());
+            result.m_values.resize(m_values.size());
+            std::vector<size_t> next(offsets.begin(), offsets.end() - 1);
+            for (unsigned outer = 0; outer < outer_size(); ++outer) {
+                for (size_t e = m_offsets[outer]; e < m_offsets[outer + 1]; ++e) {
+                    size_t slot = next[m_indices[e]]++;
+                    result.m_indices[slot] = outer;
+                    result.m_values[slot] = m_values[e];
+                }
+            }
+            return result;
+        }
+
+    public:
+        typedef T value_type;
+
+        /*!
+            \brief Пустая (нулевая) матрица
+            @param rows, cols
+            @param layout
+         */
+        explicit SparseMatrix(unsigned rows = 0, unsigned cols = 0, SparseLayout layout = SparseLayout::csr)
+                : m_rows(rows), m_cols(cols), m_layout(layout),
+                  m_offsets(size_t(layout == SparseLayout::csr ? rows : cols) + 1, 0) {}
+
+        /*!
+            \brief Построение из списка элементов (в любом порядке); значения с одинаковыми (row, col) складываются
+            @param rows, cols
+            @param entries
+            @param layout
+         */
+        SparseMatrix(unsigned rows, unsigned cols, const std::vector<Entry> &entries, SparseLayout layout = SparseLayout::csr)
+                : SparseMatrix(rows, cols, layout) {
+            bool by_rows = layout == SparseLayout::csr;
+            for (const Entry &entry : entries) {
+                if (entry.row >= rows || entry.col >= cols) {
+                    throw std::logic_error("index out of range\n");
+                }
+                ++m_offsets[(by_rows ? entry.row : entry.col) + 1];
+            }
+            std::partial_sum(m_offsets.begin(), m_offsets.end(), m_offsets.begin());
+
+            std::vector<std::pair<unsigned, T>> slots(entries.size());
+            std::vector<size_t> next(m_offsets.begin(), m_offsets.end() - 1);
+            for (const Entry &entry : entries) {
+                slots[next[by_rows ? entry.row : entry.col]++] = std::make_pair(by_rows ? entry.col : entry.row, entry.value);
+            }
+
+            // внутри строки: сортировка по индексу и слияние повторов
+            m_indices.reserve(slots.size());
+            m_values.reserve(slots.size());
+            size_t begin = 0;
+            for (unsigned outer = 0; outer < outer_size(); ++outer) {
+                size_t end = m_offsets[outer + 1];
+                std::sort(slots.begin() + begin, slots.begin() + end,
+                          [](const std::pair<unsigned, T> &a, const std::pair<unsigned, T> &b) { return a.first < b.first; });
+                for (size_t e = begin; e < end; ++e) {
+                    if (e > begin && slots[e].first == m_indices.back()) {
+                        m_values.back() += slots[e].second;
+                    } else {
+                        m_indices.push_back(slots[e].first);
+                        m_values.push_back(slots[e].second);
+                    }
+                }
+                m_offsets[outer + 1] = m_indices.size();
+                begin = end;
+            }
+        }
+
+        /*!
+            \brief Построение из готовых массивов формата (без копирования)
+            \details Индексы внутри каждой строки (столбца) должны строго возрастать - это проверяется.
+            @param rows, cols
+            @param offsets - outer + 1 неубывающих смещений, первое - 0, последнее - indices.size()
+            @param indices
+            @param values - по значению на индекс
+            @param layout
+         */
+        SparseMatrix(unsigned rows, unsigned cols, std::vector<size_t> offsets, std::vector<unsigned> indices,
+                     std::vector<T> values, SparseLayout layout = SparseLayout::csr)
+                : m_rows(rows), m_cols(cols), m_layout(layout), m_offsets(std::move(offsets)),
+                  m_indices(std::move(indices)), m_values(std::move(values)) {
+            if (m_offsets.size() != size_t(outer_size()) + 1 || m_offsets.front() != 0
+                || m_offsets.back() != m_indices.size() || m_indices.size() != m_values.size()) {
+                throw std::logic_error("matrix dimensions are not matching\n");
+            }
+            if (!std::is_sorted(m_offsets.begin(), m_offsets.end())) {
+                throw std::logic_error("matrix dimensions are not matching\n");
+            }
+            for (unsigned outer = 0; outer < outer_size(); ++outer) {
+                for (size_t e = m_offsets[outer]; e < m_offsets[outer + 1]; ++e) {
+                    if (m_indices[e] >= inner_size() || (e > m_offsets[outer] && m_indices[e - 1] >= m_indices[e])) {
+                        throw std::logic_error("index out of range\n");
+                    }
+                }
+            }
+        }
+
+        /*!
+            \brief Разреженная копия плотной матрицы (нули не хранятся)
+            @param dense
+            @param layout
+         */
+        explicit SparseMatrix(const Matrix<T> &dense, SparseLayout layout = SparseLayout::csr)
+                : SparseMatrix(dense.rows(), dense.cols(), SparseLayout::csr) {
+            const T *data = dense.data();
+            for (unsigned i = 0; i < m_rows; ++i) {
+                for (unsigned j = 0; j < m_cols; ++j) {
+                    const T &value = data[size_t(i) * m_cols + j];
+                    if (value != T(0)) {
+                        m_indices.push_back(j);
+                        m_values.push_back(value);
+                    }
+                }
+                m_offsets[i + 1] = m_indices.size();
+            }
+            if (layout == SparseLayout::csc) {
+                *this = relayout();
+            }
+        }
+
+        unsigned rows() const { return m_rows; }
+
+        unsigned cols() const { return m_cols; }
+
+        SparseLayout layout() const { return m_layout; }
+
+        /*!
+            \brief Число хранимых (ненулевых) элементов
+         */
+        size_t nonzeros() const { return m_values.size(); }
+
+        const std::vector<size_t> &offsets() const { return m_offsets; }
+
+        const std::vector<unsigned> &indices() const { return m_indices; }
+
+        const std::vector<T> &values() const { return m_values; }
+
+        std::vector<T> &values() { return m_values; }
+
+        /*!
+            \brief Элемент (i, j) (двоичный поиск в строке или столбце), для отсутствующих - ноль
+            @param i, j
+         */
+        T operator()(unsigned i, unsigned j) const {
+            if (i >= m_rows || j >= m_cols) {
+                throw std::logic_error("index out of range\n");
+            }
+            unsigned outer = m_layout == SparseLayout::csr ? i : j, inner = m_layout == SparseLayout::csr ? j : i;
+            auto first = m_indices.begin() + m_offsets[outer], last = m_indices.begin() + m_offsets[outer + 1];
+            auto it = std::lower_bound(first, last, inner);
+            return it != last && *it == inner ? m_values[it - m_indices.begin()] : T(0);
+        }
+
+        /*!
+            \brief Та же матрица в формате CSR (CSC)
+         */
+        SparseMatrix to_csr() const {
+            return m_layout == SparseLayout::csr ? *this : relayout();
+        }
+
+        SparseMatrix to_csc() const {
+            return m_layout == SparseLayout::csc ? *this : relayout();
+        }
+
+        /*!
+            \brief Плотная копия
+         */
+        Matrix<T> to_dense() const {
+            Matrix<T> dense(m_rows, m_cols);
+            T *data = dense.data();
+            for (unsigned outer = 0; outer < outer_size(); ++outer) {
+                for (size_t e = m_offsets[outer]; e < m_offsets[outer + 1]; ++e) {
+                    size_t i = m_layout == SparseLayout::csr ? outer : m_indices[e];
+                    size_t j = m_layout == SparseLayout::csr ? m_indices[e] : outer;
+                    data[i * m_cols + j] = m_values[e];
+                }
+            }
+            return dense;
+        }
+
+        SparseMatrix &operator*=(const T &k) {
+            for (T &value : m_values) {
+                value *= k;
+            }
+            return *this;
+        }
+
+        /*!
+            \brief Транспонирование без перестановки элементов: CSR матрицы A - это CSC матрицы A^T
+            \details Массивы копируются как есть, меняются только размеры и формат. Если нужен тот же формат,
+            что у исходной матрицы, - transpose(m).to_csr() (to_csc()).
+         */
+        friend SparseMatrix transpose(const SparseMatrix &m) {
+            SparseMatrix result(m);
+            std::swap(result.m_rows, result.m_cols);
+            result.m_layout = m.m_layout == SparseLayout::csr ? SparseLayout::csc : SparseLayout::csr;
+            return result;
+        }
+
+        /*!
+            \brief Произведение на плотную матрицу: S * D (D - столбец для SpMV)
+            \details Для CSR строки результата независимы и делятся между потоками общего пула. Для CSC
+            элементы столбца S разбрасываются по разным строкам результата, поэтому потоки делят столбцы D.
+            @param s
+            @param d - Matrix, FixedMatrix, представление или выражение
+            @return Matrix<T> размера s.rows() x d.cols()
+         */
+        template<class E>
+        friend Matrix<T> operator*(const SparseMatrix &s, const MatrixExpression<E> &d) {
+            static_assert(std::is_same<T, typename E::value_type>::value, "matrix element types must match");
+            if constexpr (!linalg_detail::strided_access<E>::value) {
+                return s * Matrix<T>(d);
+            } else {
+                MatrixView<T> x = linalg_detail::strided_access<E>::view(d.self());
+                if (s.m_cols != x.rows()) {
+                    throw std::logic_error("matrix dimensions are not matching\n");
+                }
+
+                Matrix<T> y(s.m_rows, x.cols());
+                T *out = y.data();
+                size_t n = x.cols();
+                size_t per_row = s.m_rows ? (s.nonzeros() + s.m_rows - 1) / s.m_rows * n : 0;
+                if (s.m_layout == SparseLayout::csr) {
+                    linalg_detail::parallel_chunks(s.m_rows, 1024, [&](size_t begin, size_t end) {
+                        for (size_t i = begin; i < end; ++i) {
+                            T *row = out + i * n;
+                            for (size_t e = s.m_offsets[i]; e < s.m_offsets[i + 1]; ++e) {
+                                const T &value = s.m_values[e];
+                                const T *source = x.data() + ptrdiff_t(s.m_indices[e]) * x.row_stride();
+                                for (size_t j = 0; j < n; ++j) {
+                                    row[j] += value * source[ptrdiff_t(j) * x.col_stride()];
+                                }
+                            }
+                        }
+                    }, std::max<size_t>(per_row, 1));
+                } else {
+                    linalg_detail::parallel_chunks(n, 1, [&](size_t begin, size_t end) {
+                        for (unsigned col = 0; col < s.m_cols; ++col) {
+                            const T *source = x.data() + ptrdiff_t(col) * x.row_stride();
+                            for (size_t e = s.m_offsets[col]; e < s.m_offsets[col + 1]; ++e) {
+                                T *row = out + size_t(s.m_indices[e]) * n;
+                                for (size_t j = begin; j < end; ++j) {
+                                    row[j] += s.m_values[e] * source[ptrdiff_t(j) * x.col_stride()];
+                                }
+                            }
+                        }
+                    }, s.nonzeros());
+                }
+                return y;
+            }
+        }
+
+        /*!
+            \brief Произведение плотной матрицы на разреженную: D * S
+            \details Строки результата независимы: строка i - это строка i матрицы D, умноженная на S.
+            @param d - Matrix, FixedMatrix, представление или выражение
+            @param s
+            @return Matrix<T> размера d.rows() x s.cols()
+         */
+        template<class E>
+        friend Matrix<T> operator*(const MatrixExpression<E> &d, const SparseMatrix &s) {
+            static_assert(std::is_same<T, typename E::value_type>::value, "matrix element types must match");
+            if constexpr (!linalg_detail::strided_access<E>::value) {
+                return Matrix<T>(d) * s;
+            } else {
+                MatrixView<T> x = linalg_detail::strided_access<E>::view(d.self());
+                if (x.cols() != s.m_rows) {
+                    throw std::logic_error("matrix dimensions are not matching\n");
+                }
+
+                Matrix<T> y(x.rows(), s.m_cols);
+                T *out = y.data();
+                size_t n = s.m_cols;
+                size_t per_row = s.nonzeros() + s.outer_size();
+                linalg_detail::parallel_chunks(x.rows(), 16, [&](size_t begin, size_t end) {
+                    for (size_t i = begin; i < end; ++i) {
+                        const T *source = x.data() + ptrdiff_t(i) * x.row_stride();
+                        T *row = out + i * n;
+                        for (unsigned outer = 0; outer < s.outer_size(); ++outer) {
+                            if (s.m_layout == SparseLayout::csr) {
+                                // строка outer матрицы S с весом D(i, outer)
+                                const T &weight = source[ptrdiff_t(outer) * x.col_stride()];
+                                for (size_t e = s.m_offsets[outer]; e < s.m_offsets[outer + 1]; ++e) {
+                                    row[s.m_indices[e]] += weight * s.m_values[e];
+                                }
+                            } else {
+                                // скалярное произведение строки D на столбец outer матрицы S
+                                T sum = 0;
+                                for (size_t e = s.m_offsets[outer]; e < s.m_offsets[outer + 1]; ++e) {
+                                    sum += source[ptrdiff_t(s.m_indices[e]) * x.col_stride()] * s.m_values[e];
+                                }
+                                row[outer] = sum;
+                            }
+                        }
+                    }
+                }, per_row);
+                return y;
+            }
+        }
+
+        // взаимодействие с потоком вывода и оператором << (элементы списком: (строка, столбец) значение)
+        friend std::ostream &operator<<(std::ostream &out, const SparseMatrix &m) {
+            out << m.m_rows << " x " << m.m_cols << ", " << m.nonzeros() << " nonzeros\n";
+            for (unsigned outer = 0; outer < m.outer_size(); ++outer) {
+                for (size_t e = m.m_offsets[outer]; e < m.m_offsets[outer + 1]; ++e) {
+                    unsigned i = m.m_layout == SparseLayout::csr ? outer : m.m_indices[e];
+                    unsigned j = m.m_layout == SparseLayout::csr ? m.m_indices[e] : outer;
+                    out << '(' << i << ", " << j << ") " << std::scientific << std::setprecision(4) << m.m_values[e] << '\n';
+                }
+            }
+            return out;
+        }
+    };
+}
@@ -0,0 +1,257 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <exception>
+#include <cstddef>
+
+/*!
+ * \brief Пул потоков с перехватом задач (work stealing) для параллельных алгоритмов библиотеки
+ * \details У каждого потока пула своя очередь задач: новые задачи поток кладёт в конец своей очереди и берёт
+ * оттуда же, а свободные потоки забирают задачи из начала чужих очередей. Задачи от потоков вне пула
+ * раскладываются по очередям по кругу. Основная операция - parallel_for: итерации раздаются участникам
+ * через атомарный счётчик, вызывающий поток тоже работает. Каждый участник получает номер из [0, size()),
+ * по нему удобно выбирать свои рабочие буферы.
+ */
+class ThreadPool {
+    typedef std::function<void()> task_type;
+
+    struct Queue {
+        std::deque<task_type> tasks;
+        std::mutex mutex;
+    };
+
+    std::vector<std::thread> workers;
+    std::vector<std::unique_ptr<Queue>> queues;  // queues[i] - очередь i-го потока пула
+    std::atomic<size_t> pending{0};              // задачи во всех очередях
+    std::atomic<size_t> next_queue{0};
+    std::mutex sleep_mutex;
+    std::condition_variable wake;
+    bool stopping = false;
+
+    inline static thread_local ThreadPool *current = nullptr;  // пул, которому принадлежит текущий поток
+    inline static thread_local size_t current_index = 0;
+
+    void start(size_t threads) {
+        if (threads == 0) {
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+        for (size_t i = 1; i < threads; ++i) {
+            queues.push_back(std::make_unique<Queue>());
+        }
+        for (size_t i = 0; i < queues.size(); ++i) {
+            workers.emplace_back([this, i] { run(i); });
+        }
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(sleep_mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+        workers.clear();
+        queues.clear();
+        stopping = false;
+    }
+
+    /*!
+     * \brief Поиск задачи: сначала конец своей очереди, затем начало чужих
+     * @return bool - true, если задача нашлась, false - иначе.
+     */
+    bool try_pop(task_type& task) {
+        size_t n = queues.size();
+        size_t own = current == this ? current_index : n;
+        if (own < n) {
+            Queue& queue = *queues[own];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (!queue.tasks.empty()) {
+                task = std::move(queue.tasks.back());
+                queue.tasks.pop_back();
+                --pending;
+                return true;
+            }
+        }
+        for (size_t i = 1; i <= n; ++i) {
+            Queue& queue = *queues[(own + i) % n];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (!queue.tasks.empty()) {
+                task = std::move(queue.tasks.front());
+                queue.tasks.pop_front();
+                --pending;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void run(size_t index) {
+        current = this;
+        current_index = index;
+        for (;;) {
+            task_type task;
+            if (try_pop(task)) {
+                task();
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(sleep_mutex);
+            wake.wait(lock, [this] { return stopping || pending > 0; });
+            if (stopping && pending == 0) {
+                return;
+            }
+        }
+    }
+
+    /*!
+     * \brief Выполнение одной задачи из очередей в текущем потоке
+     * @return bool - true, если задача нашлась, false - иначе.
+     */
+    bool run_pending() {
+        task_type task;
+        if (!try_pop(task)) {
+            return false;
+        }
+        task();
+        return true;
+    }
+
+public:
+    /*!
+     * \brief Конструктор
+     * @param threads - сколько потоков выполняют parallel_for вместе с вызывающим (0 - по числу ядер)
+     */
+    explicit ThreadPool(size_t threads = 0) {
+        start(threads);
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    ~ThreadPool() {
+        stop();
+    }
+
+    /*!
+     * \brief Общий пул библиотеки (по умолчанию потоков столько же, сколько ядер)
+     */
+    static ThreadPool& shared() {
+        static ThreadPool pool;
+        return pool;
+    }
+
+    /*!
+     * \brief Изменение числа потоков
+     * \details Уже поставленные задачи выполняются до конца. Нельзя вызывать, пока пул занят parallel_for.
+     * @param threads - новое число участников parallel_for (0 - по числу ядер, 1 - всё выполняется в вызывающем потоке)
+     */
+    void resize(size_t threads) {
+        stop();
+        start(threads);
+    }
+
+    /*!
+     * \brief Число участников parallel_for (потоки пула и вызывающий поток)
+     */
+    size_t size() const noexcept {
+        return workers.size() + 1;
+    }
+
+    /*!
+     * \brief Постановка задачи в очередь (без потоков в пуле задача выполняется сразу)
+     * @param task
+     */
+    void submit(task_type task) {
+        if (queues.empty()) {
+            task();
+            return;
+        }
+
+        size_t index = current == this ? current_index : next_queue++ % queues.size();
+        ++pending;
+        {
+            std::lock_guard<std::mutex> lock(queues[index]->mutex);
+            queues[index]->tasks.push_back(std::move(task));
+        }
+        {
+            std::lock_guard<std::mutex> lock(sleep_mutex);
+        }
+        wake.notify_one();
+    }
+
+    /*!
+     * \brief Параллельный цикл по [0, count)
+     * \details Возвращается, когда выполнены все итерации. Первое исключение из body пробрасывается
+     * вызывающему, оставшиеся итерации после него не начинаются. Пока вызывающий ждёт, он выполняет чужие
+     * задачи, поэтому parallel_for можно вызывать и изнутри другого parallel_for.
+     * @param count - число итераций
+     * @param body - body(i, worker), worker - номер участника из [0, size())
+     */
+    void parallel_for(size_t count, const std::function<void(size_t, size_t)>& body) {
+        size_t helpers = std::min(workers.size(), count > 0 ? count - 1 : 0);
+        if (helpers == 0) {
+            for (size_t i = 0; i < count; ++i) {
+                body(i, 0);
+            }
+            return;
+        }
+
+        std::atomic<size_t> next(0);
+        size_t running = helpers;           // под done_mutex
+        std::exception_ptr error;
+        std::mutex done_mutex;
+        std::condition_variable done;
+
+        auto loop = [&](size_t worker) {
+            try {
+                for (size_t i = next++; i < count; i = next++) {
+                    body(i, worker);
+                }
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(done_mutex);
+                if (!error) {
+                    error = std::current_exception();
+                }
+                next = count;
+            }
+        };
+
+        for (size_t worker = 1; worker <= helpers; ++worker) {
+            submit([&, worker] {
+                loop(worker);
+                std::lock_guard<std::mutex> lock(done_mutex);
+                if (--running == 0) {
+                    done.notify_one();
+                }
+            });
+        }
+        loop(0);
+
+        for (;;) {
+            {
+                std::lock_guard<std::mutex> lock(done_mutex);
+                if (running == 0) {
+                    break;
+                }
+            }
+            if (!run_pending()) {
+                std::unique_lock<std::mutex> lock(done_mutex);
+                done.wait(lock, [&] { return running == 0; });
+                break;
+            }
+        }
+
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+};
@@ -0,0 +1,1134 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <functional>
+#include <thread>
+#include <string>
+#include <map>
+#include <tuple>
+#include <cmath>
+#include <Graph.h>
+#include <ContractionHierarchy.h>
+#include <FixedMatrix.h>
+#include <SparseMatrix.h>
+#include <GraphMatrix.h>
+#include <MaxFlow.h>
+
+
+/*!
+ * \brief Прежняя реализация алгоритма Дейкстры (линейный поиск минимума), для сравнения
+ * @tparam graph_t
+ * @tparam weight_t
+ * @tparam route_t
+ * @tparam node_name_t
+ * @param graph
+ * @param key_from
+ * @param key_to
+ * @return Длина кратчайшего пути и сам путь.
+ */
+template<typename graph_t, typename weight_t, typename route_t, typename node_name_t>
+std::pair<weight_t, route_t> dijkstra_linear_scan(const graph_t& graph, node_name_t key_from, node_name_t key_to) {
+    route_t route;
+    std::map<node_name_t, node_name_t> route_tmp;
+    const weight_t INF = std::numeric_limits<weight_t>::max();
+    route_tmp[key_from] = std::numeric_limits<node_name_t>::max();
+
+    std::map<node_name_t, weight_t> d;
+    std::map<node_name_t, bool> used;
+    for (auto [key, node] : graph) {
+        d[key] = INF;
+        used[key] = false;
+    }
+    d[key_from] = 0;
+
+    for (size_t i = 0; i < graph.size(); i++) {
+        node_name_t v = -1;
+        for (auto [key, node] : graph) {
+            if (!used[key] && (v == -1 || d[key] < d[v])) {
+                v = key;
+            }
+        }
+        if (d[v] == INF) {
+            break;
+        }
+        used[v] = true;
+        for (auto [to, len] : graph[v]) {
+            if (d[v] + len < d[to]) {
+                d[to] = d[v] + len;
+                route_tmp[to] = v;
+            }
+        }
+    }
+
+    for (auto key = key_to; route_tmp[key] < std::numeric_limits<node_name_t>::max(); ) {
+        route.push_back(key);
+        key = route_tmp[key];
+    }
+    route.push_back(key_from);
+    std::reverse(route.begin(), route.end());
+
+    return std::pair<weight_t, route_t>(d[key_to], route);
+}
+
+
+/*!
+ * \brief Случайный разреженный граф: у каждой вершины degree исходящих рёбер
+ * @param n
+ * @param degree
+ * @param seed
+ * @return Граф с n вершинами и n * degree рёбрами (без учёта повторов).
+ */
+Graph<int, int, double> random_sparse_graph(int n, int degree, unsigned seed) {
+    std::mt19937 gen(seed);
+    std::uniform_int_distribution<int> node(0, n - 1);
+    std::uniform_real_distribution<double> weight(1.0, 100.0);
+
+    Graph<int, int, double> graph;
+    for (int i = 0; i < n; ++i) {
+        graph.insert_node(i, i);
+    }
+    for (int i = 0; i < n; ++i) {
+        graph.insert_edge({i, (i + 1) % n}, weight(gen)); // кольцо, чтобы граф был связным
+        for (int j = 1; j < degree; ++j) {
+            graph.insert_edge({i, node(gen)}, weight(gen));
+        }
+    }
+
+    return graph;
+}
+
+
+/*!
+ * \brief Решётка side x side с двусторонними рёбрами случайного веса (похожа на дорожную сеть)
+ * @param side
+ * @param seed
+ * @return Граф с side * side вершинами.
+ */
+Graph<int, int, double> grid_graph(int side, unsigned seed) {
+    std::mt19937 gen(seed);
+    std::uniform_real_distribution<double> weight(1.0, 10.0);
+
+    Graph<int, int, double> graph;
+    for (int i = 0; i < side * side; ++i) {
+        graph.insert_node(i, i);
+    }
+    for (int r = 0; r < side; ++r) {
+        for (int c = 0; c < side; ++c) {
+            int v = r * side + c;
+            if (c + 1 < side) {
+                double w = weight(gen);
+                graph.insert_edge({v, v + 1}, w);
+                graph.insert_edge({v + 1, v}, w);
+            }
+            if (r + 1 < side) {
+                double w = weight(gen);
+                graph.insert_edge({v, v + side}, w);
+                graph.insert_edge({v + side, v}, w);
+            }
+        }
+    }
+
+    return graph;
+}
+
+
+/*!
+ * \brief Координаты узла геометрического графа
+ */
+struct Coord { double x, y, z; };
+
+
+/*!
+ * \brief Решётка side x side с координатами в узлах; вес ребра - длина отрезка, умноженная на случайный множитель из [1, 1.5)
+ * @param side
+ * @param seed
+ * @return Граф с side * side вершинами.
+ */
+Graph<int, Coord, double> geometric_grid(int side, unsigned seed) {
+    std::mt19937 gen(seed);
+    std::uniform_real_distribution<double> detour(1.0, 1.5);
+
+    Graph<int, Coord, double> graph;
+    for (int r = 0; r < side; ++r) {
+        for (int c = 0; c < side; ++c) {
+            graph.insert_node(r * side + c, Coord{double(c), double(r), 0});
+        }
+    }
+    for (int r = 0; r < side; ++r) {
+        for (int c = 0; c < side; ++c) {
+            int v = r * side + c;
+            if (c + 1 < side) {
+                double w = detour(gen);
+                graph.insert_edge({v, v + 1}, w);
+                graph.insert_edge({v + 1, v}, w);
+            }
+            if (r + 1 < side) {
+                double w = detour(gen);
+                graph.insert_edge({v, v + side}, w);
+                graph.insert_edge({v + side, v}, w);
+            }
+        }
+    }
+
+    return graph;
+}
+
+
+/*!
+ * \brief Среднее время одного вызова в миллисекундах
+ * @param queries
+ * @param run
+ * @return Время в миллисекундах.
+ */
+double measure_ms(int queries, const std::function<void(int)>& run) {
+    auto start = std::chrono::steady_clock::now();
+    for (int q = 0; q < queries; ++q) {
+        run(q);
+    }
+    auto finish = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(finish - start).count() / queries;
+}
+
+
+void benchmark_dijkstra() {
+    typedef Graph<int, int, double> graph_t;
+
+    std::cout << "> Dijkstra on sparse graphs (degree 4), ms per query" << std::endl;
+    std::cout << std::setw(10) << "nodes" << std::setw(16) << "linear scan" << std::setw(16) << "binary heap"
+              << std::setw(16) << "4-ary heap" << std::setw(16) << "frozen" << std::setw(12) << "speedup" << std::endl;
+
+    for (int n : {250, 500, 1000, 2000, 100000, 1000000}) {
+        graph_t graph = random_sparse_graph(n, 4, 42);
+        auto frozen = graph.freeze();
+        std::mt19937 gen(7);
+        std::uniform_int_distribution<int> node(0, n - 1);
+        std::vector<std::pair<int, int>> pairs(n <= 2000 ? 5 : 3);
+        for (auto& [from, to] : pairs) {
+            from = node(gen);
+            to = node(gen);
+        }
+
+        double binary = measure_ms(pairs.size(), [&](int q) {
+            dijkstra<graph_t, double, std::vector<int>, int>(graph, pairs[q].first, pairs[q].second);
+        });
+        double dary = measure_ms(pairs.size(), [&](int q) {
+            dijkstra<graph_t, double, std::vector<int>, int, IndexedDaryHeap<double, 4>>(graph, pairs[q].first, pairs[q].second);
+        });
+        double csr = measure_ms(pairs.size(), [&](int q) {
+            dijkstra<CsrGraph<int, int, double>, double, std::vector<int>, int>(frozen, pairs[q].first, pairs[q].second);
+        });
+
+        std::cout << std::setw(10) << n;
+        if (n <= 2000) {
+            double linear = measure_ms(pairs.size(), [&](int q) {
+                dijkstra_linear_scan<graph_t, double, std::vector<int>, int>(graph, pairs[q].first, pairs[q].second);
+            });
+            std::cout << std::setw(16) << linear << std::setw(16) << binary << std::setw(16) << dary
+                      << std::setw(16) << csr << std::setw(11) << linear / binary << "x" << std::endl;
+        } else {
+            std::cout << std::setw(16) << "-" << std::setw(16) << binary << std::setw(16) << dary
+                      << std::setw(16) << csr << std::setw(12) << "-" << std::endl;
+        }
+    }
+}
+
+
+void benchmark_bidirectional() {
+    typedef CsrGraph<int, int, double> csr_t;
+
+    std::cout << "> Point-to-point queries on grid graphs: ms per query / vertices reached" << std::endl;
+    std::cout << std::setw(10) << "nodes" << std::setw(16) << "dijkstra" << std::setw(12) << "reached"
+              << std::setw(16) << "bidirectional" << std::setw(12) << "reached" << std::endl;
+
+    for (int side : {100, 300, 1000}) {
+        csr_t frozen = grid_graph(side, 42).freeze();
+        int n = side * side;
+        std::mt19937 gen(7);
+        std::uniform_int_distribution<int> node(0, n - 1);
+        std::vector<std::pair<int, int>> pairs(20);
+        for (auto& [from, to] : pairs) {
+            from = node(gen);
+            to = node(gen);
+        }
+
+        DijkstraWorkspace<double> forward, backward;
+        std::vector<int> route;
+        size_t reached_uni = 0, reached_bi = 0;
+
+        double uni = measure_ms(pairs.size(), [&](int q) {
+            dijkstra<csr_t, double, std::vector<int>, int>(frozen, pairs[q].first, pairs[q].second, route, forward);
+            reached_uni += forward.touched.size();
+        });
+        double bi = measure_ms(pairs.size(), [&](int q) {
+            bidirectional_dijkstra<csr_t, double, std::vector<int>, int>(frozen, pairs[q].first, pairs[q].second,
+                                                                          route, forward, backward);
+            reached_bi += forward.touched.size() + backward.touched.size();
+        });
+
+        std::cout << std::setw(10) << n << std::setw(16) << uni << std::setw(12) << reached_uni / pairs.size()
+                  << std::setw(16) << bi << std::setw(12) << reached_bi / pairs.size() << std::endl;
+    }
+}
+
+
+void benchmark_astar() {
+    typedef CsrGraph<int, Coord, double> csr_t;
+
+    std::cout << "> A* with Euclidean heuristic on geometric grids: ms per query / vertices reached" << std::endl;
+    std::cout << std::setw(10) << "nodes" << std::setw(16) << "dijkstra" << std::setw(12) << "reached"
+              << std::setw(16) << "astar" << std::setw(12) << "reached" << std::endl;
+
+    for (int side : {100, 300, 1000}) {
+        csr_t frozen = geometric_grid(side, 42).freeze();
+        int n = side * side;
+        std::mt19937 gen(7);
+        std::uniform_int_distribution<int> node(0, n - 1);
+        std::vector<std::pair<int, int>> pairs(20);
+        for (auto& [from, to] : pairs) {
+            from = node(gen);
+            to = node(gen);
+        }
+
+        DijkstraWorkspace<double> workspace;
+        std::vector<int> route;
+        size_t reached_dijkstra = 0, reached_astar = 0;
+
+        double plain = measure_ms(pairs.size(), [&](int q) {
+            dijkstra<csr_t, double, std::vector<int>, int>(frozen, pairs[q].first, pairs[q].second, route, workspace);
+            reached_dijkstra += workspace.touched.size();
+        });
+        double guided = measure_ms(pairs.size(), [&](int q) {
+            astar<csr_t, double, std::vector<int>, int>(frozen, pairs[q].first, pairs[q].second, EuclideanHeuristic(),
+                                                         route, workspace);
+            reached_astar += workspace.touched.size();
+        });
+
+        std::cout << std::setw(10) << n << std::setw(16) << plain << std::setw(12) << reached_dijkstra / pairs.size()
+                  << std::setw(16) << guided << std::setw(12) << reached_astar / pairs.size() << std::endl;
+    }
+}
+
+
+void benchmark_contraction_hierarchy() {
+    typedef CsrGraph<int, Coord, double> csr_t;
+
+    std::cout << "> Contraction hierarchies on geometric grids: preprocessing s, ms per query / vertices reached" << std::endl;
+    std::cout << std::setw(10) << "nodes" << std::setw(12) << "arcs" << std::setw(12) << "build"
+              << std::setw(16) << "dijkstra" << std::setw(12) << "reached"
+              << std::setw(16) << "hierarchy" << std::setw(12) << "reached" << std::endl;
+
+    for (int side : {50, 100, 200}) {
+        csr_t frozen = geometric_grid(side, 42).freeze();
+        int n = side * side;
+        std::mt19937 gen(7);
+        std::uniform_int_distribution<int> node(0, n - 1);
+        std::vector<std::pair<int, int>> pairs(100);
+        for (auto& [from, to] : pairs) {
+            from = node(gen);
+            to = node(gen);
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        ContractionHierarchy<int, double> hierarchy(frozen);
+        double build = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        DijkstraWorkspace<double> forward, backward;
+        std::vector<int> route;
+        size_t reached_dijkstra = 0, reached_hierarchy = 0;
+
+        double plain = measure_ms(pairs.size(), [&](int q) {
+            dijkstra<csr_t, double, std::vector<int>, int>(frozen, pairs[q].first, pairs[q].second, route, forward);
+            reached_dijkstra += forward.touched.size();
+        });
+        double fast = measure_ms(pairs.size(), [&](int q) {
+            hierarchy.query(pairs[q].first, pairs[q].second, route, forward, backward);
+            reached_hierarchy += forward.touched.size() + backward.touched.size();
+        });
+
+        std::cout << std::setw(10) << n << std::setw(12) << hierarchy.arc_count() << std::setw(12) << build
+                  << std::setw(16) << plain << std::setw(12) << reached_dijkstra / pairs.size()
+                  << std::setw(16) << fast << std::setw(12) << reached_hierarchy / pairs.size() << std::endl;
+    }
+}
+
+
+void benchmark_distance_table() {
+    typedef CsrGraph<int, int, double> csr_t;
+
+    csr_t frozen = grid_graph(300, 42).freeze();
+    std::mt19937 gen(7);
+    std::uniform_int_distribution<int> node(0, frozen.size() - 1);
+    std::vector<int> sources(16), targets(16);
+    for (int& key : sources) {
+        key = node(gen);
+    }
+    for (int& key : targets) {
+        key = node(gen);
+    }
+
+    std::cout << "> Distance table 16 x 16 on a 300 x 300 grid, ms per table (" << std::thread::hardware_concurrency()
+              << " hardware threads)" << std::endl;
+
+    DijkstraWorkspace<double> workspace;
+    std::vector<int> route;
+    double pairwise = measure_ms(1, [&](int) {
+        for (int from : sources) {
+            for (int to : targets) {
+                dijkstra<csr_t, double, std::vector<int>, int>(frozen, from, to, route, workspace);
+            }
+        }
+    });
+    std::cout << std::setw(20) << "pairwise dijkstra" << std::setw(12) << pairwise << std::endl;
+
+    for (size_t threads : {1, 2, 4, 8}) {
+        ThreadPool pool(threads);
+        double table = measure_ms(3, [&](int) {
+            distance_table<csr_t, double, int>(frozen, sources, targets, pool);
+        });
+        std::cout << std::setw(12) << threads << " threads" << std::setw(12) << table << std::endl;
+    }
+}
+
+
+void benchmark_negative_weights() {
+    typedef Graph<int, int, double> graph_t;
+
+    // веса w(u, v) + p(v) - p(u): часть рёбер отрицательна, но отрицательных циклов нет
+    int n = 100000;
+    graph_t graph = random_sparse_graph(n, 4, 42);
+    std::mt19937 gen(3);
+    std::uniform_real_distribution<double> potential(0.0, 50.0);
+    std::vector<double> p(n);
+    for (double& value : p) {
+        value = potential(gen);
+    }
+    for (auto [key, node] : graph) {
+        for (auto [to, weight] : node) {
+            graph[key][to] = weight + p[to] - p[key];
+        }
+    }
+    auto frozen = graph.freeze();
+
+    std::uniform_int_distribution<int> node(0, n - 1);
+    std::vector<int> sources(16), targets(16);
+    for (int& key : sources) {
+        key = node(gen);
+    }
+    for (int& key : targets) {
+        key = node(gen);
+    }
+
+    std::cout << "> Negative weights, 100000 nodes: 16 x 16 table, ms" << std::endl;
+    double spfa = measure_ms(1, [&](int) {
+        for (int from : sources) {
+            for (int to : targets) {
+                bellman_ford<CsrGraph<int, int, double>, double, std::vector<int>, int>(frozen, from, to);
+            }
+        }
+    });
+    double table = measure_ms(1, [&](int) {
+        johnson<CsrGraph<int, int, double>, double, int>(frozen, sources, targets);
+    });
+    std::cout << std::setw(20) << "pairwise spfa" << std::setw(12) << spfa << std::endl;
+    std::cout << std::setw(20) << "johnson" << std::setw(12) << table << std::endl;
+}
+
+
+/*!
+ * \brief Прежняя реализация умножения матриц (i-j-k через operator() с проверкой индексов), для сравнения
+ */
+template<class T>
+linalg::Matrix<T> multiply_naive(const linalg::Matrix<T>& lhs, const linalg::Matrix<T>& rhs) {
+    linalg::Matrix<T> tmp(lhs.rows(), rhs.cols());
+    for (unsigned i = 0; i < lhs.rows(); ++i) {
+        for (unsigned j = 0; j < rhs.cols(); ++j) {
+            for (unsigned k = 0; k < lhs.cols(); ++k) {
+                tmp(i, j) += lhs(i, k) * rhs(k, j);
+            }
+        }
+    }
+    return tmp;
+}
+
+
+template<class T>
+void benchmark_gemm_type(const char* name) {
+    for (unsigned n : {256, 512, 1024, 2048}) {
+        std::mt19937 gen(n);
+        std::uniform_real_distribution<T> value(-1, 1);
+        linalg::Matrix<T> a(n, n), b(n, n);
+        for (unsigned i = 0; i < n; ++i) {
+            for (unsigned j = 0; j < n; ++j) {
+                a(i, j) = value(gen);
+                b(i, j) = value(gen);
+            }
+        }
+
+        double blocked = measure_ms(1, [&](int) { a * b; });
+        double gflops = 2.0 * n * n * n / blocked / 1e6;
+
+        std::cout << std::setw(10) << name << std::setw(8) << n;
+        if (n <= 512) {
+            double naive = measure_ms(1, [&](int) { multiply_naive(a, b); });
+            std::cout << std::setw(14) << naive << std::setw(14) << blocked << std::setw(10) << gflops
+                      << std::setw(11) << naive / blocked << "x" << std::endl;
+        } else {
+            std::cout << std::setw(14) << "-" << std::setw(14) << blocked << std::setw(10) << gflops
+                      << std::setw(12) << "-" << std::endl;
+        }
+    }
+}
+
+
+void benchmark_gemm() {
+    std::cout << "> Square matrix product, ms" << std::endl;
+    std::cout << std::setw(10) << "type" << std::setw(8) << "n" << std::setw(14) << "naive" << std::setw(14) << "blocked"
+              << std::setw(10) << "GFLOPS" << std::setw(12) << "speedup" << std::endl;
+    benchmark_gemm_type<double>("double");
+    benchmark_gemm_type<float>("float");
+}
+
+
+void benchmark_matrix_threads() {
+    std::cout << "> Matrix operations on the shared pool, ms (" << std::thread::hardware_concurrency()
+              << " hardware threads)" << std::endl;
+    std::cout << std::setw(10) << "threads" << std::setw(14) << "64 x 64 *" << std::setw(14) << "2048 x 2048 *"
+              << std::setw(14) << "transpose" << std::setw(14) << "a + b" << std::endl;
+
+    linalg::Matrix<double> small(64, 64), a(2048, 2048), b(2048, 2048);
+    for (unsigned i = 0; i < 2048; ++i) {
+        for (unsigned j = 0; j < 2048; ++j) {
+            a(i, j) = double(i + j) / 2048;
+            b(i, j) = double(i) - j;
+        }
+    }
+
+    for (size_t threads : {1, 2, 4, 8}) {
+        ThreadPool::shared().resize(threads);
+        double tiny = measure_ms(1000, [&](int) { small * small; });
+        double product = measure_ms(1, [&](int) { a * b; });
+        double flipped = measure_ms(5, [&](int) { transpose(a); });
+        double sum = measure_ms(5, [&](int) { linalg::Matrix<double> c = a + b; });
+        std::cout << std::setw(10) << threads << std::setw(14) << tiny << std::setw(14) << product
+                  << std::setw(14) << flipped << std::setw(14) << sum << std::endl;
+    }
+    ThreadPool::shared().resize(0);
+}
+
+
+void benchmark_expressions() {
+    std::cout << "> a + b - 2 * c, ms" << std::endl;
+    std::cout << std::setw(10) << "n" << std::setw(14) << "temporaries" << std::setw(14) << "fused"
+              << std::setw(14) << "fused, reuse" << std::endl;
+
+    for (unsigned n : {256, 1024, 2048}) {
+        linalg::Matrix<double> a(n, n), b(n, n), c(n, n), out(n, n);
+        for (unsigned i = 0; i < n; ++i) {
+            for (unsigned j = 0; j < n; ++j) {
+                a(i, j) = double(i + j) / n;
+                b(i, j) = double(i) - j;
+                c(i, j) = double(j) / (i + 1);
+            }
+        }
+
+        // по одной временной матрице на операцию, как было до ленивых выражений
+        double eager = measure_ms(5, [&](int) {
+            linalg::Matrix<double> sum(a);
+            sum += b;
+            linalg::Matrix<double> scaled(c);
+            scaled *= 2.0;
+            sum -= scaled;
+        });
+        double fused = measure_ms(5, [&](int) { linalg::Matrix<double> r = a + b - 2.0 * c; });
+        double reuse = measure_ms(5, [&](int) { out = a + b - 2.0 * c; });
+        std::cout << std::setw(10) << n << std::setw(14) << eager << std::setw(14) << fused
+                  << std::setw(14) << reuse << std::endl;
+    }
+}
+
+void benchmark_simd() {
+    namespace simd = linalg_detail::simd;
+    const char *names[] = {"scalar", "sse2", "avx2", "avx512"};
+
+    std::cout << "> Elementwise and reduction kernels, ms per operation (detected: "
+              << names[int(simd::detect())] << ")" << std::endl;
+    std::cout << std::setw(10) << "n" << std::setw(10) << "level" << std::setw(12) << "a += b" << std::setw(12) << "a += k * b"
+              << std::setw(12) << "a *= k" << std::setw(12) << "norm" << std::setw(12) << "dot" << std::endl;
+
+    for (unsigned n : {256, 2048}) {
+        linalg::Matrix<double> a(n, n), b(n, n);
+        for (unsigned i = 0; i < n; ++i) {
+            for (unsigned j = 0; j < n; ++j) {
+                a(i, j) = double(i + j) / n;
+                b(i, j) = double(j) / (i + 1);
+            }
+        }
+
+        int repeats = n <= 256 ? 200 : 10;
+        for (int level = 0; level <= int(simd::detect()); ++level) {
+            simd::active_level() = simd::Level(level);
+            double add = measure_ms(repeats, [&](int) { a += b; });
+            double axpy = measure_ms(repeats, [&](int) { a += -1.0 * b; });
+            double scale = measure_ms(repeats, [&](int q) { a *= q % 2 ? 2.0 : 0.5; });
+            double norm = measure_ms(repeats, [&](int) { a.norm(); });
+            double dot = measure_ms(repeats, [&](int) { linalg::dot(a, b); });
+            std::cout << std::setw(10) << n << std::setw(10) << names[level] << std::setw(12) << add << std::setw(12) << axpy
+                      << std::setw(12) << scale << std::setw(12) << norm << std::setw(12) << dot << std::endl;
+        }
+        simd::active_level() = simd::detect();
+    }
+}
+
+void benchmark_fixed() {
+    typedef linalg::FixedMatrix<double, 4, 4> transform_t;
+    typedef linalg::FixedMatrix<double, 4, 1> point_t;
+
+    std::cout << "> 4 x 4 transform of 1M points, ms" << std::endl;
+    std::cout << std::setw(16) << "Matrix<double>" << std::setw(16) << "FixedMatrix" << std::setw(12) << "speedup" << std::endl;
+
+    std::mt19937 gen(4);
+    std::uniform_real_distribution<double> value(-1, 1);
+    transform_t fixed;
+    linalg::Matrix<double> dynamic(4, 4);
+    for (unsigned i = 0; i < 4; ++i) {
+        for (unsigned j = 0; j < 4; ++j) {
+            fixed(i, j) = dynamic(i, j) = value(gen);
+        }
+    }
+
+    const int points = 1000000;
+    std::vector<point_t> cloud(points);
+    for (point_t& p : cloud) {
+        p = point_t{value(gen), value(gen), value(gen), 1.0};
+    }
+
+    volatile double sink = 0;  // чтобы компилятор не выбросил преобразования
+    double heap = measure_ms(1, [&](int) {
+        for (const point_t& p : cloud) {
+            linalg::Matrix<double> v = p;
+            sink = sink + (dynamic * v)(0, 0);
+        }
+    });
+    double inline_storage = measure_ms(1, [&](int) {
+        for (const point_t& p : cloud) {
+            sink = sink + (fixed * p)(0, 0);
+        }
+    });
+    std::cout << std::setw(16) << heap << std::setw(16) << inline_storage << std::setw(11) << heap / inline_storage
+              << "x" << std::endl;
+}
+
+void benchmark_views() {
+    std::cout << "> Views instead of copies (n = 1024), ms" << std::endl;
+    std::cout << std::setw(24) << "operation" << std::setw(12) << "copy" << std::setw(12) << "view" << std::endl;
+
+    const unsigned n = 1024, half = n / 2;
+    std::mt19937 gen(n);
+    std::uniform_real_distribution<double> value(-1, 1);
+    linalg::Matrix<double> a(n, n), b(n, n);
+    for (unsigned i = 0; i < n; ++i) {
+        for (unsigned j = 0; j < n; ++j) {
+            a(i, j) = value(gen);
+            b(i, j) = value(gen);
+        }
+    }
+
+    double copy = measure_ms(1, [&](int) { linalg::Matrix<double> c = transpose(a) * b; });
+    double view = measure_ms(1, [&](int) { linalg::Matrix<double> c = a.transposed() * b; });
+    std::cout << std::setw(24) << "A^T * B" << std::setw(12) << copy << std::setw(12) << view << std::endl;
+
+    copy = measure_ms(5, [&](int) {
+        linalg::Matrix<double> lhs(half, half), rhs(half, half);
+        for (unsigned i = 0; i < half; ++i) {
+            for (unsigned j = 0; j < half; ++j) {
+                lhs(i, j) = a(i, j);
+                rhs(i, j) = b(half + i, half + j);
+            }
+        }
+        linalg::Matrix<double> c = lhs * rhs;
+    });
+    view = measure_ms(5, [&](int) { linalg::Matrix<double> c = a.block(0, 0, half, half) * b.block(half, half, half, half); });
+    std::cout << std::setw(24) << "block * block" << std::setw(12) << copy << std::setw(12) << view << std::endl;
+
+    // шаг исключения: из каждой строки вычитается первая с коэффициентом
+    copy = measure_ms(5, [&](int) {
+        linalg::Matrix<double> first(1, n);
+        for (unsigned j = 0; j < n; ++j) {
+            first(0, j) = a(0, j);
+        }
+        for (unsigned i = 1; i < n; ++i) {
+            linalg::Matrix<double> row(1, n);
+            for (unsigned j = 0; j < n; ++j) {
+                row(0, j) = a(i, j);
+            }
+            row -= 1e-3 * first;
+            for (unsigned j = 0; j < n; ++j) {
+                a(i, j) = row(0, j);
+            }
+        }
+    });
+    view = measure_ms(5, [&](int) {
+        for (unsigned i = 1; i < n; ++i) {
+            a.row(i) -= 1e-3 * a.row(0);
+        }
+    });
+    std::cout << std::setw(24) << "row -= k * pivot row" << std::setw(12) << copy << std::setw(12) << view << std::endl;
+}
+
+void benchmark_sparse() {
+    std::cout << "> Sparse matrices (CSR)" << std::endl;
+
+    // SpMV для системы 1M x 1M: плотная матрица заняла бы 8 ТБ
+    const unsigned n = 1000000, per_row = 5;
+    std::mt19937 gen(n);
+    std::uniform_real_distribution<double> value(-1, 1);
+    std::vector<linalg::SparseMatrix<double>::Entry> entries;
+    entries.reserve(size_t(n) * per_row);
+    for (unsigned i = 0; i < n; ++i) {
+        for (unsigned k = 0; k < per_row; ++k) {
+            entries.push_back({i, unsigned(gen() % n), value(gen)});
+        }
+    }
+    linalg::SparseMatrix<double> s(n, n, entries);
+    linalg::Matrix<double> x(n, 1);
+    for (unsigned i = 0; i < n; ++i) {
+        x(i, 0) = value(gen);
+    }
+    size_t bytes = s.offsets().size() * sizeof(size_t) + s.nonzeros() * (sizeof(unsigned) + sizeof(double));
+    double spmv = measure_ms(10, [&](int) { linalg::Matrix<double> y = s * x; });
+    std::cout << "SpMV " << n << " x " << n << ", " << s.nonzeros() << " nonzeros (" << bytes / (1 << 20) << " MB): "
+              << spmv << " ms, " << s.nonzeros() / spmv / 1e3 << " Mnnz/s" << std::endl;
+
+    // sparse x dense против dense x dense при плотности 1%
+    const unsigned m = 1024;
+    linalg::Matrix<double> a(m, m), b(m, m);
+    for (unsigned i = 0; i < m; ++i) {
+        for (unsigned j = 0; j < m; ++j) {
+            a(i, j) = gen() % 100 == 0 ? value(gen) : 0;
+            b(i, j) = value(gen);
+        }
+    }
+    linalg::SparseMatrix<double> sa(a);
+    double dense = measure_ms(1, [&](int) { linalg::Matrix<double> c = a * b; });
+    double sparse = measure_ms(1, [&](int) { linalg::Matrix<double> c = sa * b; });
+    std::cout << std::setw(24) << "A * B, 1% of A (ms)" << std::setw(12) << "dense" << std::setw(12) << "sparse" << std::endl;
+    std::cout << std::setw(24) << m << std::setw(12) << dense << std::setw(12) << sparse << std::endl;
+}
+
+void benchmark_graph_matrix() {
+    std::cout << "> Graph as a sparse matrix (1000 x 1000 grid): number of walks of length 8 from every node, ms"
+              << std::endl;
+
+    const int side = 1000, n = side * side, length = 8;
+    Graph<int, int, double> graph = grid_graph(side, 42);
+
+    GraphMatrix<int> adjacency;
+    double build = measure_ms(1, [&](int) { adjacency = graph_matrix(graph, GraphMatrixKind::adjacency, false); });
+
+    // обход: на каждом шаге по всем вершинам и их рёбрам в Graph
+    std::vector<double> walks(n, 1), next(n);
+    double traversal = measure_ms(1, [&](int) {
+        for (int step = 0; step < length; ++step) {
+            for (const auto& [key, node] : graph) {
+                double sum = 0;
+                for (const auto& [to, weight] : node) {
+                    sum += walks[to];
+                }
+                next[key] = sum;
+            }
+            walks.swap(next);
+        }
+    });
+
+    linalg::Matrix<double> x(n, 1);
+    for (int i = 0; i < n; ++i) {
+        x(i, 0) = 1;
+    }
+    double spmv = measure_ms(1, [&](int) {
+        for (int step = 0; step < length; ++step) {
+            x = adjacency.matrix * x;
+        }
+    });
+
+    std::cout << std::setw(16) << "export" << std::setw(16) << "traversal" << std::setw(16) << "SpMV" << std::endl;
+    std::cout << std::setw(16) << build << std::setw(16) << traversal << std::setw(16) << spmv
+              << (x(adjacency.index(n / 2), 0) == walks[n / 2] ? "" : "  (mismatch)") << std::endl;
+}
+
+/*!
+ * \brief Итерации PageRank "push" по рёбрам Graph (разброс вклада по исходящим рёбрам), для сравнения
+ */
+size_t pagerank_push(const Graph<int, int, double>& graph, double damping, double tol, std::vector<double>& rank) {
+    size_t n = graph.size();
+    rank.assign(n, 1.0 / n);
+    std::vector<double> next(n);
+    for (size_t iteration = 1; iteration <= 100; ++iteration) {
+        double dangling = 0;
+        std::fill(next.begin(), next.end(), 0.0);
+        for (const auto& [key, node] : graph) {
+            if (node.size() == 0) {
+                dangling += rank[key];
+            }
+            for (const auto& [to, weight] : node) {
+                next[to] += rank[key] / node.size();
+            }
+        }
+        double change = 0;
+        for (size_t v = 0; v < n; ++v) {
+            next[v] = (1 - damping) / n + damping * (next[v] + dangling / n);
+            change += std::abs(next[v] - rank[v]);
+        }
+        rank.swap(next);
+        if (change < tol) {
+            return iteration;
+        }
+    }
+    return 100;
+}
+
+void benchmark_pagerank() {
+    typedef CsrGraph<int, int, double> csr_t;
+
+    // случайный граф с перекосом степеней: концы рёбер чаще попадают в вершины с малыми номерами
+    const int n = 200000, m = 2000000;
+    std::mt19937 gen(n);
+    std::uniform_real_distribution<double> unit(0, 1);
+    Graph<int, int, double> graph;
+    for (int i = 0; i < n; ++i) {
+        graph.insert_node(i, i);
+    }
+    for (int k = 0; k < m; ++k) {
+        int from = static_cast<int>(gen() % n), to = static_cast<int>(n * unit(gen) * unit(gen));
+        graph.insert_edge({from, to}, 1);
+    }
+    csr_t frozen = graph.freeze();
+    size_t edges = frozen.edge_count();
+
+    std::cout << "> PageRank, " << n << " nodes, " << edges << " edges, tol = 1e-6 ("
+              << ThreadPool::shared().size() << " threads)" << std::endl;
+    std::cout << std::setw(24) << "variant" << std::setw(12) << "ms" << std::setw(12) << "iterations"
+              << std::setw(16) << "Medges/s" << std::endl;
+
+    std::vector<double> rank;
+    size_t iterations = 0;
+    double push = measure_ms(1, [&](int) { iterations = pagerank_push(graph, 0.85, 1e-6, rank); });
+    std::cout << std::setw(24) << "push over Graph" << std::setw(12) << push << std::setw(12) << iterations
+              << std::setw(16) << iterations * edges / push / 1e3 << std::endl;
+
+    double whole = measure_ms(1, [&](int) { auto scores = pagerank(graph); });
+    double pull = measure_ms(1, [&](int) {
+        iterations = graph_detail::pagerank(frozen, 0.85, 1e-6, 100, rank, ThreadPool::shared());
+    });
+    std::cout << std::setw(24) << "pull over snapshot" << std::setw(12) << pull << std::setw(12) << iterations
+              << std::setw(16) << iterations * edges / pull / 1e3 << std::endl;
+    std::cout << std::setw(24) << "pagerank(Graph)" << std::setw(12) << whole << std::setw(12) << iterations
+              << std::setw(16) << iterations * edges / whole / 1e3 << std::endl;
+}
+
+void benchmark_bfs() {
+    typedef CsrGraph<int, int, double> csr_t;
+
+    std::cout << "> Unweighted traversal: dijkstra with unit weights vs BFS, ms per query ("
+              << ThreadPool::shared().size() << " threads)" << std::endl;
+    std::cout << std::setw(28) << "graph" << std::setw(12) << "dijkstra" << std::setw(12) << "top-down"
+              << std::setw(12) << "dir.-opt." << std::endl;
+
+    // решётка: длинные пути и узкий фронт; случайный граф: несколько уровней с огромным фронтом
+    std::vector<std::pair<std::string, Graph<int, int, double>>> graphs;
+    graphs.emplace_back("grid 1000 x 1000", grid_graph(1000, 42));
+    const int n = 200000, m = 2000000;
+    std::mt19937 gen(n);
+    Graph<int, int, double> random;
+    for (int i = 0; i < n; ++i) {
+        random.insert_node(i, i);
+    }
+    for (int k = 0; k < m; ++k) {
+        random.insert_edge({static_cast<int>(gen() % n), static_cast<int>(gen() % n)}, 1);
+    }
+    graphs.emplace_back("random 200K nodes, 2M edges", std::move(random));
+
+    for (auto& [name, graph] : graphs) {
+        for (auto& node : graph) {
+            for (auto& edge : node.second) {
+                edge.second = 1;
+            }
+        }
+        csr_t frozen = graph.freeze();
+        int nodes = static_cast<int>(frozen.size());
+        std::uniform_int_distribution<int> node(0, nodes - 1);
+        std::vector<std::pair<int, int>> pairs(10);
+        for (auto& [from, to] : pairs) {
+            from = node(gen);
+            to = node(gen);
+        }
+
+        DijkstraWorkspace<double> ws;
+        std::vector<int> route;
+        std::vector<uint32_t> hops, parent;
+        double dijkstra_ms = measure_ms(pairs.size(), [&](int q) {
+            dijkstra<csr_t, double, std::vector<int>, int>(frozen, pairs[q].first, pairs[q].second, route, ws);
+        });
+        double top_down = measure_ms(pairs.size(), [&](int q) {
+            graph_detail::bfs(frozen, frozen.index(pairs[q].first), frozen.index(pairs[q].second), hops, parent,
+                              ThreadPool::shared(), false);
+        });
+        double optimized = measure_ms(pairs.size(), [&](int q) { hop_distance(frozen, pairs[q].first, pairs[q].second); });
+        std::cout << std::setw(28) << name << std::setw(12) << dijkstra_ms << std::setw(12) << top_down
+                  << std::setw(12) << optimized << std::endl;
+    }
+}
+
+/*!
+ * \brief Компоненты слабой связности обходом Graph (метки в std::map), для сравнения
+ */
+size_t weak_components_by_traversal(const Graph<int, int, double>& graph) {
+    std::map<int, std::vector<int>> neighbours;
+    for (const auto& [key, node] : graph) {
+        for (const auto& [to, weight] : node) {
+            neighbours[key].push_back(to);
+            neighbours[to].push_back(key);
+        }
+    }
+    std::map<int, size_t> label;
+    size_t count = 0;
+    for (const auto& [key, node] : graph) {
+        if (label.count(key)) {
+            continue;
+        }
+        std::vector<int> stack{key};
+        label[key] = count;
+        while (!stack.empty()) {
+            int v = stack.back();
+            stack.pop_back();
+            for (int to : neighbours[v]) {
+                if (label.emplace(to, count).second) {
+                    stack.push_back(to);
+                }
+            }
+        }
+        ++count;
+    }
+    return count;
+}
+
+void benchmark_components() {
+    typedef CsrGraph<int, int, double> csr_t;
+
+    std::cout << "> Connected components, ms (" << ThreadPool::shared().size() << " threads)" << std::endl;
+    std::cout << std::setw(28) << "graph" << std::setw(12) << "traversal" << std::setw(12) << "weak"
+              << std::setw(12) << "strong" << std::setw(16) << "weak / strong" << std::endl;
+
+    // разреженный случайный граф: много компонент обоих видов; цепочка замкнута в цикл - одна компонента глубиной n
+    const int n = 200000;
+    std::mt19937 gen(n);
+    Graph<int, int, double> random, cycle;
+    for (int i = 0; i < n; ++i) {
+        random.insert_node(i, i);
+    }
+    for (int k = 0; k < n; ++k) {
+        random.insert_edge({static_cast<int>(gen() % n), static_cast<int>(gen() % n)}, 1);
+    }
+    const int length = 1000000;
+    for (int i = 0; i < length; ++i) {
+        cycle.insert_node(i, i);
+    }
+    for (int i = 0; i < length; ++i) {
+        cycle.insert_edge({i, (i + 1) % length}, 1);
+    }
+
+    for (auto [name, graph] : {std::make_pair("random, 200K nodes / edges", &random),
+                               std::make_pair("cycle of 1M nodes", &cycle)}) {
+        csr_t frozen = graph->freeze();
+        size_t weak = 0, strong = 0;
+        double traversal = measure_ms(1, [&](int) { weak_components_by_traversal(*graph); });
+        double weak_ms = measure_ms(3, [&](int) { weak = weak_components(frozen).count; });
+        double strong_ms = measure_ms(3, [&](int) { strong = strong_components(frozen).count; });
+        std::cout << std::setw(28) << name << std::setw(12) << traversal << std::setw(12) << weak_ms
+                  << std::setw(12) << strong_ms << std::setw(16) << std::to_string(weak) + " / " + std::to_string(strong)
+                  << std::endl;
+    }
+}
+
+void benchmark_spanning_forest() {
+    typedef CsrGraph<int, int, double> csr_t;
+
+    std::cout << "> Minimum spanning forest, ms (" << ThreadPool::shared().size() << " threads)" << std::endl;
+    std::cout << std::setw(28) << "graph" << std::setw(12) << "kruskal" << std::setw(12) << "prim"
+              << std::setw(12) << "boruvka" << std::setw(16) << "total weight" << std::endl;
+
+    const int n = 200000, m = 2000000;
+    std::mt19937 gen(n);
+    std::uniform_real_distribution<double> weight(1.0, 10.0);
+    Graph<int, int, double> random;
+    for (int i = 0; i < n; ++i) {
+        random.insert_node(i, i);
+    }
+    for (int k = 0; k < m; ++k) {
+        random.insert_edge({static_cast<int>(gen() % n), static_cast<int>(gen() % n)}, weight(gen));
+    }
+
+    std::vector<std::pair<std::string, csr_t>> graphs;
+    graphs.emplace_back("grid 1000 x 1000", grid_graph(1000, 42).freeze());
+    graphs.emplace_back("random 200K nodes, 2M edges", random.freeze());
+    for (const auto& [name, frozen] : graphs) {
+        double total = 0;
+        double kruskal_ms = measure_ms(1, [&](int) { total = kruskal(frozen).total; });
+        double prim_ms = measure_ms(1, [&](int) { prim(frozen); });
+        double boruvka_ms = measure_ms(1, [&](int) { boruvka(frozen); });
+        std::cout << std::setw(28) << name << std::setw(12) << kruskal_ms << std::setw(12) << prim_ms
+                  << std::setw(12) << boruvka_ms << std::setw(16) << total << std::endl;
+    }
+}
+
+void benchmark_max_flow() {
+    typedef CsrGraph<int, int, double> csr_t;
+
+    std::cout << "> Maximum flow, ms" << std::endl;
+    std::cout << std::setw(28) << "graph" << std::setw(14) << "push-relabel" << std::setw(12) << "dinic"
+              << std::setw(16) << "flow" << std::endl;
+
+    // случайный граф: исток и сток - вершины 0 и n - 1
+    const int n = 100000, m = 1000000;
+    std::mt19937 gen(n);
+    std::uniform_real_distribution<double> capacity(1.0, 10.0);
+    Graph<int, int, double> random;
+    for (int i = 0; i < n; ++i) {
+        random.insert_node(i, i);
+    }
+    for (int k = 0; k < m; ++k) {
+        random.insert_edge({static_cast<int>(gen() % n), static_cast<int>(gen() % n)}, std::floor(capacity(gen)));
+    }
+
+    // решётка: исток -1 соединён с левым столбцом, правый столбец - со стоком -2
+    const int side = 200;
+    Graph<int, int, double> grid = grid_graph(side, 42);
+    grid.insert_node(-1, -1);
+    grid.insert_node(-2, -2);
+    for (int r = 0; r < side; ++r) {
+        grid.insert_edge({-1, r * side}, 1000);
+        grid.insert_edge({r * side + side - 1, -2}, 1000);
+    }
+
+    std::vector<std::tuple<std::string, csr_t, int, int>> graphs;
+    graphs.emplace_back("grid 200 x 200, side to side", grid.freeze(), -1, -2);
+    graphs.emplace_back("random 100K nodes, 1M edges", random.freeze(), 0, n - 1);
+    for (const auto& [name, frozen, source, sink] : graphs) {
+        double value = 0, check = 0;
+        double push_relabel = measure_ms(1, [&, source = source, sink = sink](int) {
+            value = max_flow(frozen, source, sink).value;
+        });
+        double dinic_ms = measure_ms(1, [&, source = source, sink = sink](int) {
+            check = dinic(frozen, source, sink).value;
+        });
+        std::cout << std::setw(28) << name << std::setw(14) << push_relabel << std::setw(12) << dinic_ms
+                  << std::setw(16) << value << (std::abs(value - check) < 1e-6 * value ? "" : "  (mismatch)") << std::endl;
+    }
+}
+
+/*!
+ * \brief Прежний определитель (разложение по первой строке), для сравнения
+ */
+template<class T>
+T det_cofactor(const linalg::Matrix<T>& m) {
+    unsigned n = m.rows();
+    if (n == 1) {
+        return m(0, 0);
+    }
+
+    T d = 0;
+    int sgn = 1;
+    linalg::Matrix<T> minor(n - 1, n - 1);
+    for (unsigned c = 0; c < n; ++c) {
+        for (unsigned i = 1; i < n; ++i) {
+            for (unsigned j = 0, k = 0; j < n; ++j) {
+                if (j != c) {
+                    minor(i - 1, k++) = m(i, j);
+                }
+            }
+        }
+        d += sgn * m(0, c) * det_cofactor(minor);
+        sgn = -sgn;
+    }
+    return d;
+}
+
+
+void benchmark_det() {
+    std::cout << "> Determinant, ms" << std::endl;
+    std::cout << std::setw(10) << "n" << std::setw(14) << "cofactor" << std::setw(14) << "lu" << std::endl;
+
+    for (unsigned n : {8, 10, 100, 500, 1000, 2000}) {
+        std::mt19937 gen(n);
+        std::uniform_real_distribution<double> value(-1, 1);
+        linalg::Matrix<double> a(n, n);
+        for (unsigned i = 0; i < n; ++i) {
+            for (unsigned j = 0; j < n; ++j) {
+                a(i, j) = value(gen);
+            }
+        }
+
+        double lu = measure_ms(1, [&](int) { a.det(); });
+        std::cout << std::setw(10) << n;
+        if (n <= 10) {
+            std::cout << std::setw(14) << measure_ms(1, [&](int) { det_cofactor(a); });
+        } else {
+            std::cout << std::setw(14) << "-";
+        }
+        std::cout << std::setw(14) << lu << std::endl;
+    }
+}
+
+
+void benchmark_inverse() {
+    std::cout << "> Inverse and solve, ms" << std::endl;
+    std::cout << std::setw(10) << "n" << std::setw(14) << "inverse" << std::setw(14) << "solve(n rhs)"
+              << std::setw(14) << "solve(1 rhs)" << std::endl;
+
+    for (unsigned n : {100, 500, 1000}) {
+        std::mt19937 gen(n);
+        std::uniform_real_distribution<double> value(-1, 1);
+        linalg::Matrix<double> a(n, n), b(n, n), x(n, 1);
+        for (unsigned i = 0; i < n; ++i) {
+            for (unsigned j = 0; j < n; ++j) {
+                a(i, j) = value(gen);
+                b(i, j) = value(gen);
+            }
+            x(i, 0) = value(gen);
+        }
+
+        std::cout << std::setw(10) << n
+                  << std::setw(14) << measure_ms(1, [&](int) { linalg::inverse(a); })
+                  << std::setw(14) << measure_ms(1, [&](int) { linalg::solve(a, b); })
+                  << std::setw(14) << measure_ms(1, [&](int) { linalg::solve(a, x); }) << std::endl;
+    }
+}
+
+int main() {
+    std::cout << std::fixed << std::setprecision(3);
+
+    benchmark_dijkstra();
+    benchmark_bidirectional();
+    benchmark_astar();
+    benchmark_contraction_hierarchy();
+    benchmark_distance_table();
+    benchmark_negative_weights();
+    benchmark_gemm();
+    benchmark_matrix_threads();
+    benchmark_expressions();
+    benchmark_simd();
+    benchmark_fixed();
+    benchmark_views();
+    benchmark_sparse();
+    benchmark_graph_matrix();
+    benchmark_pagerank();
+    benchmark_bfs();
+    benchmark_components();
+    benchmark_spanning_forest();
+    benchmark_max_flow();
+    benchmark_det();
+    benchmark_inverse();
+
+    return 0;
+}
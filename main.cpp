@@ -132,6 +132,7 @@ int main() {/*
         graph.at("fourth") = Point{4, 4, 4};
         try { graph.at("fifth"); }
         catch (std::exception &ex) { std::cout << ex.what() << std::endl; }
+        std::cout << graph.id("third") << " -> " << graph.key(graph.id("third")) << std::endl; // Плотный номер узла и обратно
         auto [it4, flag4] = graph.insert_edge({"first", "second"}, 44.44);
         std::cout << std::boolalpha << flag4 << std::endl; // => true
         auto [it5, flag5] = graph.insert_edge({"first", "second"}, 55.55);
@@ -203,6 +204,24 @@ int main() {/*
     }
     //  */
 
+    {
+        Graph<int, int, double> tracked(true); // Индекс входящих рёбер: degree_in() без обхода графа
+        for (int key = 1; key <= 4; ++key) {
+            tracked.insert_node(key, key);
+        }
+        tracked.insert_edge({1, 2}, 1);
+        tracked.insert_edge({3, 2}, 1);
+        tracked.insert_edge({4, 2}, 1);
+        tracked.insert_edge({2, 4}, 1);
+        std::cout << tracked.degree_in(2) << " " << tracked.degree_in(4) << std::endl; // => 3 1
+        tracked.erase_node(3); // Узел 4 получает номер удалённого узла, индекс это учитывает
+        std::cout << tracked.degree_in(2) << " " << tracked.degree_in(4) << std::endl; // => 2 1
+        auto moved = std::move(tracked[1]); // Рёбра уходят из графа вместе с узлом
+        std::cout << tracked.degree_out(1) << " " << tracked.degree_in(2) << " " << moved.size() << std::endl; // => 0 1 1
+        tracked.erase_edges_go_to(2);
+        std::cout << tracked.degree_in(2) << " " << tracked.degree_out(4) << std::endl; // => 0 0
+    }
+
     std::cout << "\n";
 
     Graph<int, int, double> graph_for_dijkstra;
@@ -233,6 +252,18 @@ int main() {/*
     }
     std::cout << "\n";
 
+    auto frozen = graph_for_dijkstra.freeze(); // Неизменяемый снимок графа для частых запросов
+    print(frozen);
+
+    auto [weight_frozen, route_frozen] = dijkstra<CsrGraph<int, int, double>, double, std::vector<int>, int>(frozen, 2, 1);
+
+    std::cout << weight_frozen << "\n";
+
+    for (auto item : route_frozen) {
+        std::cout << item << " ";
+    }
+    std::cout << "\n";
+
     try {
         auto [weight1, route1] = dijkstra<Graph<int, int, double>, double, std::vector<int>, int>(graph_for_dijkstra, 2, 5);
     }
@@ -249,6 +280,28 @@ int main() {/*
         std::cout << e.what() << "\n";
     }
 
+    auto [weight_bf, route_bf] = bellman_ford<Graph<int, int, double>, double, std::vector<int>, int>(graph_for_dijkstra, 2, 1);
+
+    std::cout << weight_bf << "\n";
+
+    for (auto item : route_bf) {
+        std::cout << item << " ";
+    }
+    std::cout << "\n";
+
+    std::vector<int> all_keys = {0, 1, 2, 3, 4};
+    auto all_pairs = johnson<Graph<int, int, double>, double, int>(graph_for_dijkstra, all_keys, all_keys);
+    for (unsigned i = 0; i < all_pairs.rows(); ++i) {
+        for (unsigned j = 0; j < all_pairs.cols(); ++j) {
+            if (all_pairs(i, j) == std::numeric_limits<double>::max()) {
+                std::cout << "- ";
+            } else {
+                std::cout << all_pairs(i, j) << " ";
+            }
+        }
+        std::cout << "\n";
+    }
+
     graph_for_dijkstra.erase_edges_go_from(4);
     graph_for_dijkstra.insert_edge({4, 3}, 1);
     graph_for_dijkstra.insert_edge({4, 1}, 8);
@@ -262,5 +315,42 @@ int main() {/*
         std::cout << e.what() << "\n";
     }
 
+    Graph<std::string, Point, double> roads;
+    roads.insert_node("home", {0, 0, 0});
+    roads.insert_node("park", {3, 4, 0});
+    roads.insert_node("shop", {6, 0, 0});
+    roads.insert_node("work", {6, 8, 0});
+    roads.insert_edge({"home", "park"}, 5);
+    roads.insert_edge({"home", "shop"}, 6);
+    roads.insert_edge({"park", "work"}, 5);
+    roads.insert_edge({"shop", "work"}, 8);
+
+    auto frozen_roads = roads.freeze();
+    DijkstraWorkspace<double> workspace; // Буферы переиспользуются между запросами
+    std::vector<std::string> road_route;
+    for (const char* target : {"park", "shop", "work"}) {
+        double road_weight = dijkstra<CsrGraph<std::string, Point, double>, double, std::vector<std::string>, std::string>(
+                frozen_roads, "home", target, road_route, workspace);
+
+        std::cout << road_weight << ":";
+        for (const auto& item : road_route) {
+            std::cout << " " << item;
+        }
+        std::cout << "\n";
+    }
+
+    auto [astar_weight, astar_route] = astar<CsrGraph<std::string, Point, double>, double, std::vector<std::string>, std::string>(
+            frozen_roads, "home", "work", EuclideanHeuristic()); // Оценка остатка пути по координатам узлов
+
+    std::cout << astar_weight << ":";
+    for (const auto& item : astar_route) {
+        std::cout << " " << item;
+    }
+    std::cout << "\n";
+
+    std::vector<std::string> depots = {"home", "park"}, clients = {"shop", "work"};
+    auto table = distance_table<CsrGraph<std::string, Point, double>, double, std::string>(frozen_roads, depots, clients);
+    std::cout << table;
+
     return 0;
 }